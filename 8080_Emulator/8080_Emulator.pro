@@ -1,9 +1,13 @@
 QT       += core gui
-QT       += multimedia
+QT       += multimedia network
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++11
 
+# Build with "qmake CONFIG+=cpu_profiling" to count opcode, address and call cycles in the Cpu,
+# see src/profiler/profiler.h. Profiling is compiled out otherwise.
+cpu_profiling: DEFINES += CPU_PROFILING
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
@@ -12,18 +16,66 @@ SOURCES += \
     src/instructionWindow.cpp \
     src/main.cpp \
     src/mainWindow.cpp \
+    src/audio/audioMixer.cpp \
+    src/audio/audioThread.cpp \
+    src/audio/soundSource.cpp \
+    src/audio/soundSynth.cpp \
+    src/audio/wavDecoder.cpp \
+    src/benchmark/benchmark.cpp \
+    src/conformance/cpmRunner.cpp \
+    src/cpu/blockCache.cpp \
     src/cpu/cpu.cpp \
     src/emulator/emulator.cpp \
     src/flags/flags.cpp \
-    src/gui/gui.cpp
+    src/fuzz/fuzzer.cpp \
+    src/fuzz/referenceCpu.cpp \
+    src/gui/gui.cpp \
+    src/io/ioBus.cpp \
+    src/io/shiftRegister.cpp \
+    src/jit/jit.cpp \
+    src/latency/latencyMonitor.cpp \
+    src/machine/machine.cpp \
+    src/metrics/metrics.cpp \
+    src/metrics/metricsExporter.cpp \
+    src/options/options.cpp \
+    src/profiler/profiler.cpp \
+    src/rom/romLoader.cpp \
+    src/trace/traceReader.cpp \
+    src/trace/traceWriter.cpp
 
 HEADERS += \
     src/instructionWindow.h \
     src/mainWindow.h \
+    src/audio/audioMixer.h \
+    src/audio/audioThread.h \
+    src/audio/soundSource.h \
+    src/audio/soundSynth.h \
+    src/audio/wavDecoder.h \
+    src/benchmark/benchmark.h \
+    src/concurrency/hostClock.h \
+    src/concurrency/spscQueue.h \
+    src/conformance/cpmRunner.h \
+    src/cpu/blockCache.h \
     src/cpu/cpu.h \
+    src/cpu/cycles.h \
     src/emulator/emulator.h \
     src/flags/flags.h \
-    src/gui/gui.h
+    src/fuzz/fuzzer.h \
+    src/fuzz/referenceCpu.h \
+    src/gui/gui.h \
+    src/io/ioBus.h \
+    src/io/shiftRegister.h \
+    src/jit/jit.h \
+    src/latency/latencyMonitor.h \
+    src/machine/machine.h \
+    src/metrics/metrics.h \
+    src/metrics/metricsExporter.h \
+    src/options/options.h \
+    src/profiler/profiler.h \
+    src/rom/romLoader.h \
+    src/trace/trace.h \
+    src/trace/traceReader.h \
+    src/trace/traceWriter.h
 
 FORMS += \
     src/instructionWindow.ui \
@@ -32,6 +84,16 @@ FORMS += \
 RC_ICONS = src/space_invader_icon.ico
 
 RESOURCES = src/res.qrc
+
+# Build with "qmake CONFIG+=embed_rom" to compile roms/invaders.rom into the program, so it
+# starts without reading any rom file, see src/rom/romLoader.h. The resources are left
+# uncompressed so the image is used in place, rcc would otherwise pick zstd where it can.
+embed_rom {
+    DEFINES += EMBEDDED_ROM
+    RESOURCES += src/rom.qrc
+    QMAKE_RESOURCE_FLAGS += -no-compress
+}
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
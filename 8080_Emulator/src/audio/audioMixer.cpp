@@ -0,0 +1,138 @@
+/**************************************************************************************************
+    ** File Name: audioMixer.cpp
+    ** Description: Contains the member function definitions for the AudioMixer class.
+**************************************************************************************************/
+#include <QDebug>
+#include <QFile>
+
+#include "audioMixer.h"
+#include "wavDecoder.h"
+
+//the resource each sound is decoded from, in the order of the Sound enum
+static const char *SOUND_FILES[SOUND_COUNT] = {
+    ":/sounds/ufo_highpitch.wav",
+    ":/sounds/shoot.wav",
+    ":/sounds/explosion.wav",
+    ":/sounds/invaderkilled.wav",
+    ":/sounds/fastinvader1.wav",
+    ":/sounds/fastinvader2.wav",
+    ":/sounds/fastinvader3.wav",
+    ":/sounds/fastinvader4.wav",
+    ":/sounds/ufo_lowpitch.wav"
+};
+
+
+/**************************************************************************************************
+    ** Function Name: AudioMixer::AudioMixer()
+    ** Description: The default constructor for the AudioMixer class, starts with every voice
+        silent. Nothing is decoded until load is called.
+**************************************************************************************************/
+AudioMixer::AudioMixer()
+{
+    for(int sound = 0; sound < SOUND_COUNT; ++sound){
+        voices[sound].position = -1;
+        voices[sound].loop = false;
+    }
+    port3 = 0;
+    port5 = 0;
+    loaded = false;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool AudioMixer::load()
+    ** Description: Reads and decodes every sound into PCM at AUDIO_SAMPLE_RATE. Returns false,
+        after reporting what went wrong, if any sound cannot be read or decoded.
+**************************************************************************************************/
+bool AudioMixer::load(){
+    for(int sound = 0; sound < SOUND_COUNT; ++sound){
+        QFile file(SOUND_FILES[sound]);
+        if(!file.open(QIODevice::ReadOnly)){
+            qWarning("Failed to open the sound %s", SOUND_FILES[sound]);
+            return false;
+        }
+        QString error;
+        if(!WavDecoder::decode(file.readAll(), AUDIO_SAMPLE_RATE, samples[sound], error)){
+            qWarning("Failed to decode the sound %s: %s", SOUND_FILES[sound], qPrintable(error));
+            return false;
+        }
+    }
+    loaded = true;
+    return true;
+}
+
+//checks if every sound has been decoded
+bool AudioMixer::isLoaded(){
+    return loaded;
+}
+
+
+
+/**************************************************************************************************
+    ** Function Name: void AudioMixer::changeSounds(uint8_t &latch, uint8_t value, ...)
+    ** Description: Compares the bits written to a sound port with the ones in latch, the value
+        last written. Each bit that rose starts its sound, counting up from firstSound; a bit
+        in loops keeps its sound repeating until the bit falls, every other sound plays once
+        to its end. Each bit is handled on its own, so sounds triggered by the same write all
+        play.
+**************************************************************************************************/
+void AudioMixer::changeSounds(uint8_t &latch, uint8_t value, int firstSound, int count,
+                              uint8_t loops){
+    uint8_t rising = value & ~latch;
+    uint8_t falling = latch & ~value & loops;
+    for(int bit = 0; bit < count; ++bit){
+        Voice &voice = voices[firstSound + bit];
+        if((rising >> bit) & 1){
+            voice.position = 0;
+            voice.loop = (loops >> bit) & 1;
+        }
+        else if((falling >> bit) & 1){
+            voice.position = -1;
+        }
+    }
+    latch = value;
+}
+
+//port 3 holds the repeating ufo and three one-shots, port 5 the four notes of the fleet moving
+//and the ufo being hit
+void AudioMixer::portWritten(uint8_t port, uint8_t value){
+    if(port == 3){
+        changeSounds(port3, value, SOUND_UFO_HIGH_PITCH, 4, 0x01);
+    }
+    else if(port == 5){
+        changeSounds(port5, value, SOUND_FAST_INVADER_1, 5, 0x00);
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void AudioMixer::renderSamples(int16_t *output, int frames)
+    ** Description: Writes the next frames samples of every playing voice added together into
+        output, clipped to 16 bits. Voices that reach their end stop, or start over if they
+        loop.
+**************************************************************************************************/
+void AudioMixer::renderSamples(int16_t *output, int frames){
+    accumulator.fill(0, frames);
+    for(int sound = 0; sound < SOUND_COUNT; ++sound){
+        Voice &voice = voices[sound];
+        const QVector<int16_t> &sample = samples[sound];
+        if(voice.position < 0 || sample.isEmpty()){
+            continue;
+        }
+        for(int frame = 0; frame < frames; ++frame){
+            if(voice.position >= sample.size()){
+                if(!voice.loop){
+                    voice.position = -1;
+                    break;
+                }
+                voice.position = 0;
+            }
+            accumulator[frame] += sample[voice.position++] * AUDIO_VOLUME;
+        }
+    }
+
+    for(int frame = 0; frame < frames; ++frame){
+        int32_t value = accumulator[frame] >> 8;
+        output[frame] = value > 32767 ? 32767 : (value < -32768 ? -32768 : value);
+    }
+}
@@ -0,0 +1,48 @@
+/**************************************************************************************************
+    ** File Name: audioMixer.h
+    ** Description: This file contains the Class declaration for the AudioMixer class. Every
+        sound the cabinet makes is decoded from its .wav once, by load, and kept as PCM. The
+        bits written to ports 3 and 5 start and stop the sounds on the audio thread, which adds
+        up the playing voices, so the emulator never waits on audio and any number of sounds
+        can overlap.
+**************************************************************************************************/
+#include <QVector>
+#include <stdint.h>
+
+#include "soundSource.h"
+
+#ifndef AUDIOMIXER_H
+#define AUDIOMIXER_H
+
+const int AUDIO_VOLUME = 128;                   //gain applied to each voice, 256 is full scale
+
+class AudioMixer : public SoundSource
+{
+public:
+    AudioMixer();                               //default constructor
+
+    bool load();                                //decodes every sound, false if one is missing
+    bool isLoaded();
+
+protected:
+    void portWritten(uint8_t port, uint8_t value);      //starts and stops sounds
+    void renderSamples(int16_t *output, int frames);    //mixes the playing voices
+
+private:
+    //one voice per sound, a sound started again while playing starts over
+    struct Voice{
+        int position;                           //next sample, -1 when the voice is silent
+        bool loop;
+    };
+
+    void changeSounds(uint8_t &latch, uint8_t value, int firstSound, int count, uint8_t loops);
+
+    QVector<int16_t> samples[SOUND_COUNT];
+    Voice voices[SOUND_COUNT];
+    uint8_t port3;                              //port values as last seen by the audio thread
+    uint8_t port5;
+    QVector<int32_t> accumulator;               //sums the voices before they are clipped
+    bool loaded;
+};
+
+#endif // AUDIOMIXER_H
@@ -0,0 +1,83 @@
+/**************************************************************************************************
+    ** File Name: audioThread.cpp
+    ** Description: Contains the member function definitions for the AudioThread class.
+**************************************************************************************************/
+#include <QAudioDeviceInfo>
+#include <QAudioFormat>
+#include <QAudioOutput>
+#include <QDebug>
+#include <QTimer>
+
+#include "audioThread.h"
+#include "../metrics/metrics.h"
+
+
+//the constructor for the AudioThread class, source must outlive the thread
+AudioThread::AudioThread(SoundSource *source) : source(source)
+{
+}
+
+//destructor for the AudioThread class, stops the thread if it is still running
+AudioThread::~AudioThread(){
+    stop();
+}
+
+//ends the thread's event loop, which closes the output, and waits for it to finish
+void AudioThread::stop(){
+    if(isRunning()){
+        quit();
+        wait();
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void AudioThread::run()
+    ** Description: Opens the default output as 16 bit mono at AUDIO_SAMPLE_RATE and, every
+        AUDIO_FILL_INTERVAL milliseconds, renders as many periods as the device has room for.
+        The output is created here so it belongs to this thread. Without a usable device the
+        thread ends straight away and the game runs silently.
+**************************************************************************************************/
+void AudioThread::run(){
+    QAudioFormat format;
+    format.setSampleRate(AUDIO_SAMPLE_RATE);
+    format.setChannelCount(1);
+    format.setSampleSize(16);
+    format.setCodec("audio/pcm");
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setSampleType(QAudioFormat::SignedInt);
+
+    QAudioDeviceInfo device = QAudioDeviceInfo::defaultOutputDevice();
+    if(device.isNull() || !device.isFormatSupported(format)){
+        qWarning("No audio output supports 16 bit mono at %d Hz, sound is off", AUDIO_SAMPLE_RATE);
+        return;
+    }
+
+    QAudioOutput output(device, format);
+    output.setBufferSize(AUDIO_BUFFER_FRAMES * sizeof(int16_t));
+    QIODevice *stream = output.start();
+    if(stream == nullptr){
+        qWarning("Failed to start the audio output, sound is off");
+        return;
+    }
+
+    //the output goes idle when it has played everything it was given
+    connect(&output, &QAudioOutput::stateChanged, [](QAudio::State state){
+        if(state == QAudio::IdleState){
+            Metrics::instance().audioUnderruns.add();
+        }
+    });
+
+    int16_t period[AUDIO_PERIOD_FRAMES];
+    QTimer timer;
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, [&](){
+        while(output.bytesFree() >= (int)sizeof(period)){
+            source->render(period, AUDIO_PERIOD_FRAMES);
+            stream->write((const char*)period, sizeof(period));
+        }
+    });
+    timer.start(AUDIO_FILL_INTERVAL);
+    exec();
+    output.stop();
+}
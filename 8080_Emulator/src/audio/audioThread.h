@@ -0,0 +1,35 @@
+/**************************************************************************************************
+    ** File Name: audioThread.h
+    ** Description: This file contains the Class declaration for the AudioThread class, the
+        thread that owns the audio output. It keeps the output's buffer topped up with periods
+        rendered by a SoundSource, so mixing or synthesising and talking to the audio device all
+        happen away from the emulation thread.
+**************************************************************************************************/
+#include <QThread>
+
+#include "soundSource.h"
+
+#ifndef AUDIOTHREAD_H
+#define AUDIOTHREAD_H
+
+const int AUDIO_PERIOD_FRAMES = 256;            //frames rendered at a time, about 6 ms
+const int AUDIO_BUFFER_FRAMES = 2048;           //frames the audio device buffers, about 46 ms
+const int AUDIO_FILL_INTERVAL = 5;              //milliseconds between checks of the device buffer
+
+
+class AudioThread : public QThread
+{
+    Q_OBJECT
+public:
+    AudioThread(SoundSource *source);           //constructor
+    ~AudioThread();                             //destructor
+
+    void stop();                                //closes the output and waits for the thread
+
+private:
+    void run();                                 //opens the output and keeps it fed until stopped
+
+    SoundSource *source;
+};
+
+#endif // AUDIOTHREAD_H
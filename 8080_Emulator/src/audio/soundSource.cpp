@@ -0,0 +1,94 @@
+/**************************************************************************************************
+    ** File Name: soundSource.cpp
+    ** Description: Contains the member function definitions for the SoundSource class.
+**************************************************************************************************/
+#include <string.h>
+
+#include "soundSource.h"
+
+
+//the default constructor for the SoundSource class, the cycle to sample mapping is set by the
+//first write
+SoundSource::SoundSource()
+{
+    memset(&timing, 0, sizeof(Timing));
+    hasPending = false;
+    synced = false;
+    renderedCycle = 0;
+    publishedCycle.store(-1);
+}
+
+//hands a write to the audio thread along with the emulated cycle it happened on
+bool SoundSource::writePort(uint8_t port, uint8_t value, uint64_t cycle){
+    PortWrite write = {cycle, port, value};
+    return writes.push(write);
+}
+
+//lets the emulation thread see how far the audio has got, in the cycles of the writes
+int64_t SoundSource::renderedCycles(){
+    return publishedCycle.load(std::memory_order_acquire);
+}
+
+//fills write with the next write without taking it, false if there is none
+bool SoundSource::nextWrite(PortWrite &write){
+    if(!hasPending){
+        hasPending = writes.pop(pending);
+    }
+    write = pending;
+    return hasPending;
+}
+
+//returns the sample, counted from the next one rendered, that cycle falls on
+int64_t SoundSource::sampleOffset(uint64_t cycle){
+    return ((int64_t)cycle * AUDIO_SAMPLE_RATE - renderedCycle) / AUDIO_CPU_CLOCK;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void SoundSource::render(int16_t *output, int frames)
+    ** Description: Renders the next frames samples, stopping at the sample each waiting write
+        is due on to apply it, so a write changes the sound at the sample its cycle maps to.
+        The first write sets the mapping so it plays AUDIO_WRITE_DELAY samples later, which
+        leaves room for the emulation running ahead in bursts. Writes due in an earlier
+        buffer are applied at once and counted as late; a write that is more than a delay late
+        or AUDIO_RESYNC_LIMIT delays early means the emulation was paused or sped up, so the
+        mapping is set again from it.
+**************************************************************************************************/
+void SoundSource::render(int16_t *output, int frames){
+    int done = 0;
+    PortWrite write;
+    while(nextWrite(write)){
+        if(!synced){
+            renderedCycle = (int64_t)write.cycle * AUDIO_SAMPLE_RATE
+                          - (int64_t)AUDIO_WRITE_DELAY * AUDIO_CPU_CLOCK;
+            synced = true;
+        }
+        int64_t offset = sampleOffset(write.cycle);
+        if(offset < done - AUDIO_WRITE_DELAY || offset > AUDIO_WRITE_DELAY * AUDIO_RESYNC_LIMIT){
+            synced = false;
+            timing.resyncs++;
+            continue;
+        }
+        if(offset >= frames){
+            break;                              //due in a later buffer
+        }
+        if(offset > done){
+            renderSamples(output + done, offset - done);
+            done = offset;
+        }
+        else if(offset < done){
+            timing.late++;
+            if(done - offset > timing.latest){
+                timing.latest = done - offset;
+            }
+        }
+        portWritten(write.port, write.value);
+        timing.writes++;
+        hasPending = false;
+    }
+    if(done < frames){
+        renderSamples(output + done, frames - done);
+    }
+    renderedCycle += (int64_t)frames * AUDIO_CPU_CLOCK;
+    publishedCycle.store(synced ? renderedCycle / AUDIO_SAMPLE_RATE : -1, std::memory_order_release);
+}
@@ -0,0 +1,86 @@
+/**************************************************************************************************
+    ** File Name: soundSource.h
+    ** Description: This file contains the Class declaration for the SoundSource class, what the
+        AudioThread plays from, and the sounds of the cabinet. The emulation thread hands every
+        change to the sound ports over with the emulated cycle it happened on, through a
+        lock-free queue. On the audio thread render works out which sample each cycle falls on
+        and applies the change right there, so sounds keep the spacing they had in the
+        emulation however the two threads are scheduled. The AudioMixer plays the recorded
+        samples and the SoundSynth makes the sounds from scratch.
+**************************************************************************************************/
+#include <atomic>
+#include <stdint.h>
+
+#include "../concurrency/spscQueue.h"
+
+#ifndef SOUNDSOURCE_H
+#define SOUNDSOURCE_H
+
+const int AUDIO_SAMPLE_RATE = 44100;            //rate every sound is made at
+const int AUDIO_CPU_CLOCK = 1996800;            //emulated cycles per second, as the writes count them
+const int AUDIO_COMMAND_SLOTS = 256;            //port writes that can wait for the audio thread
+const int AUDIO_WRITE_DELAY = 735;              //samples, a frame, between a write and its sound
+const int AUDIO_RESYNC_LIMIT = 4;               //writes this many delays early or a delay late resync
+
+//the sounds, named after their files in src/sounds
+enum Sound{
+    SOUND_UFO_HIGH_PITCH,
+    SOUND_SHOOT,
+    SOUND_EXPLOSION,
+    SOUND_INVADER_KILLED,
+    SOUND_FAST_INVADER_1,
+    SOUND_FAST_INVADER_2,
+    SOUND_FAST_INVADER_3,
+    SOUND_FAST_INVADER_4,
+    SOUND_UFO_LOW_PITCH,
+    SOUND_COUNT
+};
+
+class SoundSource
+{
+public:
+    SoundSource();                              //default constructor
+    virtual ~SoundSource(){}
+
+    //called from the emulation thread, false if the audio thread has fallen behind
+    bool writePort(uint8_t port, uint8_t value, uint64_t cycle);
+
+    //writes the next frames 16 bit mono samples to output, called from the audio thread
+    void render(int16_t *output, int frames);
+
+    //the cycle the next sample to be rendered belongs to, -1 until a write has set the mapping
+    int64_t renderedCycles();
+
+    //how well the writes kept to their cycles, only read once the audio thread has stopped
+    struct Timing{
+        uint64_t writes;
+        uint64_t late;                          //writes applied after the sample they were due on
+        int latest;                             //samples the latest write was late by
+        uint64_t resyncs;                       //times the cycle to sample mapping was set again
+    } timing;
+
+protected:
+    //applies a write to port 3 or 5, at the point in the output the write's cycle falls on
+    virtual void portWritten(uint8_t port, uint8_t value) = 0;
+    //writes the next frames samples of whatever is playing to output
+    virtual void renderSamples(int16_t *output, int frames) = 0;
+
+private:
+    struct PortWrite{
+        uint64_t cycle;
+        uint8_t port;
+        uint8_t value;
+    };
+
+    bool nextWrite(PortWrite &write);
+    int64_t sampleOffset(uint64_t cycle);
+
+    SpscQueue<PortWrite, AUDIO_COMMAND_SLOTS> writes;
+    PortWrite pending;                          //the next write, taken off the queue early to look at
+    bool hasPending;
+    bool synced;                                //false until the first write sets the mapping
+    int64_t renderedCycle;                      //cycle of the next sample, times AUDIO_SAMPLE_RATE
+    std::atomic<int64_t> publishedCycle;        //renderedCycles, as last left by render
+};
+
+#endif // SOUNDSOURCE_H
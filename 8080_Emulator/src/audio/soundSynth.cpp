@@ -0,0 +1,175 @@
+/**************************************************************************************************
+    ** File Name: soundSynth.cpp
+    ** Description: Contains the member function definitions for the SoundSynth class.
+**************************************************************************************************/
+#include <math.h>
+#include <string.h>
+
+#include "soundSynth.h"
+
+const int SYNTH_MIN_FREQUENCY = 20;             //a falling pitch stops sliding here
+const int SYNTH_RELEASE = 30;                   //decay in milliseconds of a held voice let go
+const int32_t SYNTH_SILENCE = 1 << 12;          //level below which a voice is stopped
+
+//returns the volume kept each sample, as a 16 bit fraction, to fall to a third in milliseconds
+static int32_t decayPerSample(int milliseconds){
+    return exp(-1000.0 / ((double)milliseconds * AUDIO_SAMPLE_RATE)) * 65536;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: SoundSynth::SoundSynth()
+    ** Description: The default constructor for the SoundSynth class, works each preset out into
+        the per sample steps render uses, so render never does anything but integer arithmetic.
+**************************************************************************************************/
+SoundSynth::SoundSynth()
+{
+    //in the order of the Sound enum. The ufo warbles while it flies, shots and hits are falling
+    //bursts of noise and the fleet's four notes are low thumps
+    static const Preset PRESETS[SOUND_COUNT] = {
+        {TRIANGLE,  700,      0,  8, 300,   0, true },  //ufo flying
+        {NOISE,    6000, -20000,  0,   0, 200, false},  //shot
+        {NOISE,    2000,  -1000,  0,   0, 600, false},  //player explosion
+        {NOISE,    4000,  -8000,  0,   0, 150, false},  //invader killed
+        {SQUARE,     62,      0,  0,   0,  80, false},  //fleet notes, from highest to lowest
+        {SQUARE,     56,      0,  0,   0,  80, false},
+        {SQUARE,     50,      0,  0,   0,  80, false},
+        {SQUARE,     46,      0,  0,   0,  80, false},
+        {SQUARE,    440,      0, 16, 200, 800, false},  //ufo hit
+    };
+
+    const double stepsPerHz = 4294967296.0 / AUDIO_SAMPLE_RATE;
+    memset(voices, 0, sizeof(voices));
+    for(int sound = 0; sound < SOUND_COUNT; ++sound){
+        const Preset &preset = PRESETS[sound];
+        Voice &voice = voices[sound];
+        voice.waveform = preset.waveform;
+        voice.startStep = preset.frequency * stepsPerHz;
+        voice.sweep = preset.sweep * stepsPerHz / AUDIO_SAMPLE_RATE;
+        voice.vibratoStep = preset.vibratoRate * stepsPerHz;
+        voice.vibratoDepth = preset.vibratoDepth * stepsPerHz;
+        voice.decay = preset.decay > 0 ? decayPerSample(preset.decay) : 65536;
+        voice.held = preset.held;
+    }
+    releaseDecay = decayPerSample(SYNTH_RELEASE);
+    port3 = 0;
+    port5 = 0;
+}
+
+//starts and lets go of the voices on whichever port was written
+void SoundSynth::portWritten(uint8_t port, uint8_t value){
+    if(port == 3){
+        writeSounds(port3, value, SOUND_UFO_HIGH_PITCH, 4);
+    }
+    else if(port == 5){
+        writeSounds(port5, value, SOUND_FAST_INVADER_1, 5);
+    }
+}
+
+//starts voice from the top of its sound
+void SoundSynth::start(Voice &voice){
+    voice.phase = 0;
+    voice.step = voice.startStep;
+    voice.vibratoPhase = 0;
+    voice.level = SYNTH_LEVEL;
+    voice.releasing = false;
+    voice.noise = 0x7FFF;
+    voice.noiseValue = 32767;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void SoundSynth::writeSounds(uint8_t &latch, uint8_t value, ...)
+    ** Description: Compares the bits written to a sound port with the ones in latch, starting
+        the voice of each bit that rose and letting go of each held voice whose bit fell. Bit n
+        of the port is the sound firstSound + n.
+**************************************************************************************************/
+void SoundSynth::writeSounds(uint8_t &latch, uint8_t value, int firstSound, int count){
+    uint8_t rising = value & ~latch;
+    uint8_t falling = latch & ~value;
+    for(int bit = 0; bit < count; ++bit){
+        Voice &voice = voices[firstSound + bit];
+        if((rising >> bit) & 1){
+            start(voice);
+        }
+        else if(((falling >> bit) & 1) && voice.held){
+            voice.releasing = true;
+        }
+    }
+    latch = value;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: int32_t SoundSynth::nextSample(Voice &voice)
+    ** Description: Returns the voice's next sample and moves it on by one sample: the phase
+        advances by the step, warbled by the vibrato, the step slides by the sweep, and the
+        level dies away unless the voice is held. The voice goes silent once its level is too
+        small to hear.
+**************************************************************************************************/
+int32_t SoundSynth::nextSample(Voice &voice){
+    uint32_t step = voice.step;
+    if(voice.vibratoDepth != 0){
+        voice.vibratoPhase += voice.vibratoStep;
+        uint32_t position = voice.vibratoPhase >> 16;
+        int32_t triangle = position < 0x8000 ? (int32_t)position * 2 - 0x8000
+                                             : (int32_t)(0xFFFF - position) * 2 - 0x8000;
+        step += ((int64_t)triangle * voice.vibratoDepth) >> 15;
+    }
+    uint32_t before = voice.phase;
+    voice.phase += step;
+
+    int64_t slid = (int64_t)voice.step + voice.sweep;
+    int64_t lowest = (int64_t)SYNTH_MIN_FREQUENCY * 4294967296LL / AUDIO_SAMPLE_RATE;
+    voice.step = slid < lowest ? lowest : slid;
+
+    int32_t wave;
+    switch(voice.waveform){
+    case SQUARE:
+        wave = (voice.phase & 0x80000000) ? -32767 : 32767;
+        break;
+    case TRIANGLE:
+    {
+        uint32_t position = voice.phase >> 16;
+        wave = position < 0x8000 ? (int32_t)position * 2 - 0x8000
+                                 : (int32_t)(0xFFFF - position) * 2 - 0x8000;
+        break;
+    }
+    default:
+        //a new random level every time the phase wraps, from a 15 bit shift register
+        if(voice.phase < before){
+            uint16_t feedback = (voice.noise ^ (voice.noise >> 1)) & 1;
+            voice.noise = (voice.noise >> 1) | (feedback << 14);
+            voice.noiseValue = (voice.noise & 1) ? 32767 : -32767;
+        }
+        wave = voice.noiseValue;
+        break;
+    }
+    int32_t sample = ((int64_t)wave * voice.level) >> 30;
+
+    if(!voice.held || voice.releasing){
+        voice.level = ((int64_t)voice.level * (voice.releasing ? releaseDecay : voice.decay)) >> 16;
+        if(voice.level < SYNTH_SILENCE){
+            voice.level = 0;
+        }
+    }
+    return sample;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void SoundSynth::renderSamples(int16_t *output, int frames)
+    ** Description: Adds up the next frames samples of every voice that is sounding into output,
+        clipped to 16 bits.
+**************************************************************************************************/
+void SoundSynth::renderSamples(int16_t *output, int frames){
+    for(int frame = 0; frame < frames; ++frame){
+        int32_t sum = 0;
+        for(int sound = 0; sound < SOUND_COUNT; ++sound){
+            if(voices[sound].level != 0){
+                sum += nextSample(voices[sound]);
+            }
+        }
+        output[frame] = sum > 32767 ? 32767 : (sum < -32768 ? -32768 : sum);
+    }
+}
@@ -0,0 +1,74 @@
+/**************************************************************************************************
+    ** File Name: soundSynth.h
+    ** Description: This file contains the Class declaration for the SoundSynth class, a sound
+        source that makes the cabinet's sounds from the bits written to ports 3 and 5 instead of
+        playing recordings. Each sound is a voice with a waveform, a pitch that can slide or
+        warble and a volume that dies away, roughly following the analog circuit it stands in
+        for. Nothing is loaded, and render only uses fixed point arithmetic on state allocated
+        up front, so it is safe to run from a real-time audio callback.
+**************************************************************************************************/
+#include "soundSource.h"
+
+#ifndef SOUNDSYNTH_H
+#define SOUNDSYNTH_H
+
+const int SYNTH_LEVEL = 1 << 28;                //starting volume of a voice, 1 << 30 is full scale
+
+
+class SoundSynth : public SoundSource
+{
+public:
+    SoundSynth();                               //default constructor
+
+protected:
+    void portWritten(uint8_t port, uint8_t value);      //starts and lets go of voices
+    void renderSamples(int16_t *output, int frames);    //synthesises the playing voices
+
+private:
+    enum Waveform{
+        SQUARE,
+        TRIANGLE,
+        NOISE                                   //random levels, changed at the voice's pitch
+    };
+
+    //how each sound is made, in units that are easy to tune
+    struct Preset{
+        Waveform waveform;
+        int frequency;                          //starting pitch in Hz
+        int sweep;                              //change of pitch in Hz per second
+        int vibratoRate;                        //warbles per second, 0 for a steady pitch
+        int vibratoDepth;                       //how far the warble moves the pitch in Hz
+        int decay;                              //milliseconds for the volume to fall to a third
+        bool held;                              //keeps sounding for as long as its bit is set
+    };
+
+    //a preset worked out into per sample steps, and where the voice has got to
+    struct Voice{
+        Waveform waveform;
+        uint32_t startStep;                     //phase added per sample at the starting pitch
+        int32_t sweep;                          //change of step per sample
+        uint32_t vibratoStep;
+        uint32_t vibratoDepth;                  //largest change of step from the warble
+        int32_t decay;                          //volume kept each sample, 16 bit fraction
+        bool held;
+
+        uint32_t phase;
+        uint32_t step;
+        uint32_t vibratoPhase;
+        int32_t level;                          //current volume, 0 when the voice is silent
+        bool releasing;                         //the bit of a held voice has fallen
+        uint16_t noise;                         //shift register the noise comes from
+        int32_t noiseValue;
+    };
+
+    void writeSounds(uint8_t &latch, uint8_t value, int firstSound, int count);
+    void start(Voice &voice);
+    int32_t nextSample(Voice &voice);
+
+    Voice voices[SOUND_COUNT];
+    int32_t releaseDecay;                       //volume kept each sample once a held voice is let go
+    uint8_t port3;                              //port values as last seen by the audio thread
+    uint8_t port5;
+};
+
+#endif // SOUNDSYNTH_H
@@ -0,0 +1,116 @@
+/**************************************************************************************************
+    ** File Name: wavDecoder.cpp
+    ** Description: Contains the member function definitions for the WavDecoder class.
+**************************************************************************************************/
+#include <string.h>
+
+#include "wavDecoder.h"
+
+const int WAV_FORMAT_PCM = 1;                   //the only format tag the decoder accepts
+
+
+//reads a little endian 16 or 32 bit value out of a header
+static uint32_t readLittleEndian(const uint8_t *bytes, int size){
+    uint32_t value = 0;
+    for(int i = size - 1; i >= 0; --i){
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+//averages the channels of one frame into a signed 16 bit sample, 8 bit samples are unsigned
+int16_t WavDecoder::readSample(const uint8_t *frame, int channels, int bitsPerSample){
+    int sum = 0;
+    for(int channel = 0; channel < channels; ++channel){
+        if(bitsPerSample == 8){
+            sum += (frame[channel] - 128) << 8;
+        }
+        else{
+            sum += (int16_t)readLittleEndian(frame + channel * 2, 2);
+        }
+    }
+    return sum / channels;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool WavDecoder::decode(const QByteArray &file, int outputRate, ...)
+    ** Description: Walks the RIFF chunks of file for the fmt and data chunks and converts the
+        data into samples at outputRate. Returns false with a reason in error if the file is not
+        a PCM .wav the decoder can read, leaving samples empty.
+**************************************************************************************************/
+bool WavDecoder::decode(const QByteArray &file, int outputRate, QVector<int16_t> &samples,
+                        QString &error){
+    samples.clear();
+    const uint8_t *bytes = (const uint8_t*)file.constData();
+    int size = file.size();
+    if(size < 12 || memcmp(bytes, "RIFF", 4) != 0 || memcmp(bytes + 8, "WAVE", 4) != 0){
+        error = "not a RIFF WAVE file";
+        return false;
+    }
+
+    int channels = 0;
+    int rate = 0;
+    int bitsPerSample = 0;
+    const uint8_t *data = nullptr;
+    int dataSize = 0;
+    for(int offset = 12; offset + 8 <= size; ){
+        uint32_t chunkSize = readLittleEndian(bytes + offset + 4, 4);
+        const uint8_t *chunk = bytes + offset + 8;
+        uint32_t available = size - offset - 8;
+        if(memcmp(bytes + offset, "fmt ", 4) == 0){
+            if(chunkSize < 16 || available < 16){
+                error = "fmt chunk is too short";
+                return false;
+            }
+            if(readLittleEndian(chunk, 2) != WAV_FORMAT_PCM){
+                error = "only uncompressed PCM is supported";
+                return false;
+            }
+            channels = readLittleEndian(chunk + 2, 2);
+            rate = readLittleEndian(chunk + 4, 4);
+            bitsPerSample = readLittleEndian(chunk + 14, 2);
+        }
+        else if(memcmp(bytes + offset, "data", 4) == 0){
+            data = chunk;
+            dataSize = chunkSize < available ? chunkSize : available;  //allow a truncated file
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);      //chunks are padded to an even size
+    }
+
+    if(channels == 0){
+        error = "no fmt chunk";
+        return false;
+    }
+    if(data == nullptr){
+        error = "no data chunk";
+        return false;
+    }
+    if((bitsPerSample != 8 && bitsPerSample != 16) || rate <= 0){
+        error = QString("unsupported format, %1 bit at %2 Hz").arg(bitsPerSample).arg(rate);
+        return false;
+    }
+
+    //convert to mono at the file's own rate, then resample to the output rate
+    int frameSize = channels * bitsPerSample / 8;
+    int frames = dataSize / frameSize;
+    QVector<int16_t> mono(frames);
+    for(int frame = 0; frame < frames; ++frame){
+        mono[frame] = readSample(data + frame * frameSize, channels, bitsPerSample);
+    }
+    if(rate == outputRate || frames < 2){
+        samples = mono;
+        return true;
+    }
+
+    int outputFrames = (int)((int64_t)frames * outputRate / rate);
+    samples.resize(outputFrames);
+    for(int i = 0; i < outputFrames; ++i){
+        int64_t position = (int64_t)i * rate * 256 / outputRate;   //8 bits of fraction
+        int index = position >> 8;
+        int fraction = position & 0xFF;
+        int next = index + 1 < frames ? index + 1 : index;
+        samples[i] = (mono[index] * (256 - fraction) + mono[next] * fraction) >> 8;
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+/**************************************************************************************************
+    ** File Name: wavDecoder.h
+    ** Description: This file contains the Class declaration for the WavDecoder class, which turns
+        an uncompressed PCM .wav file into the 16 bit mono samples the AudioMixer plays, at the
+        mixer's sample rate. 8 and 16 bit files with any number of channels are read; the
+        channels are averaged and the sample rate is converted by linear interpolation.
+**************************************************************************************************/
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <stdint.h>
+
+#ifndef WAVDECODER_H
+#define WAVDECODER_H
+
+
+class WavDecoder
+{
+public:
+    static bool decode(const QByteArray &file, int outputRate, QVector<int16_t> &samples,
+                       QString &error);
+
+private:
+    static int16_t readSample(const uint8_t *frame, int channels, int bitsPerSample);
+};
+
+#endif // WAVDECODER_H
@@ -0,0 +1,252 @@
+/**************************************************************************************************
+    ** File Name: benchmark.cpp
+    ** Description: Contains the member function definitions for the Benchmark class.
+**************************************************************************************************/
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+
+#include "benchmark.h"
+#include "../cpu/cpu.h"
+#include "../emulator/emulator.h"
+#include "../options/options.h"
+
+const uint16_t FAMILY_CODE = 0x1000;            //where the opcode family loops are placed
+const uint16_t FAMILY_SUBROUTINE = 0x2000;      //a lone RET for the call family to call
+const int FAMILY_CODE_SIZE = 0x300;             //bytes of repeated instructions in each loop
+
+//a family of opcode handlers and a short run of instructions that exercises it, the run is
+//repeated to fill FAMILY_CODE_SIZE and closed with a jump back to the start
+struct OpcodeFamily{
+    const char *name;
+    int length;
+    uint8_t code[24];
+    bool jumpsToNext;                           //3 byte branches whose target is patched to the next one
+};
+
+static const OpcodeFamily OPCODE_FAMILIES[] = {
+    {"move", 6, {0x41, 0x4A, 0x53, 0x5C, 0x65, 0x78}, false},
+    {"move_memory", 4, {0x70, 0x7E, 0x36, 0x55}, false},
+    {"load_immediate", 12, {0x06, 0x12, 0x0E, 0x34, 0x3E, 0x56, 0x01, 0x00, 0x31, 0x11, 0x00, 0x32}, false},
+    {"alu_register", 8, {0x80, 0x88, 0x90, 0x98, 0xA0, 0xA8, 0xB0, 0xB8}, false},
+    {"alu_memory", 8, {0x86, 0x8E, 0x96, 0x9E, 0xA6, 0xAE, 0xB6, 0xBE}, false},
+    {"alu_immediate", 16, {0xC6, 0x01, 0xCE, 0x02, 0xD6, 0x03, 0xDE, 0x04,
+                           0xE6, 0xFF, 0xEE, 0x05, 0xF6, 0x00, 0xFE, 0x06}, false},
+    {"increment", 8, {0x04, 0x0C, 0x05, 0x0D, 0x03, 0x0B, 0x34, 0x35}, false},
+    {"register_pair", 6, {0x09, 0x19, 0xEB, 0xEB, 0x23, 0x2B}, false},
+    {"load_store", 16, {0x3A, 0x00, 0x30, 0x32, 0x01, 0x30, 0x2A, 0x02, 0x30, 0x22, 0x04, 0x30,
+                        0x0A, 0x02, 0x1A, 0x12}, false},
+    {"rotate", 8, {0x07, 0x0F, 0x17, 0x1F, 0x27, 0x2F, 0x37, 0x3F}, false},
+    {"stack", 10, {0xC5, 0xD5, 0xE5, 0xF5, 0xF1, 0xE1, 0xD1, 0xC1, 0xE3, 0xE3}, false},
+    {"jump", 15, {0xC3, 0, 0, 0xC2, 0, 0, 0xCA, 0, 0, 0xD2, 0, 0, 0xDA, 0, 0}, true},
+    {"call_return", 9, {0xCD, 0x00, 0x20, 0xC4, 0x00, 0x20, 0xCC, 0x00, 0x20}, false},
+    {"input_output", 12, {0xDB, 0x01, 0xDB, 0x02, 0xD3, 0x02, 0xD3, 0x04, 0xDB, 0x03, 0xD3, 0x06}, false},
+    {"shift_register", 10, {0xD3, 0x02, 0xD3, 0x04, 0xDB, 0x03, 0xD3, 0x04, 0xDB, 0x03}, false},
+    {"control", 3, {0x00, 0xFB, 0xF3}, false},
+};
+
+
+/**************************************************************************************************
+    ** Function Name: int Benchmark::run(const QString &path)
+    ** Description: Runs every benchmark, prints a summary and writes the results to path as
+        JSON, or to standard output if path is "-". Returns 0 on success and 1 if the rom or the
+        output file could not be opened, for use as the program's exit code.
+**************************************************************************************************/
+int Benchmark::run(const QString &path){
+    opcodeFamilies();
+    frames();
+    startup();
+    if(results.isEmpty()){
+        return 1;
+    }
+
+    QJsonObject build;
+    build["block_cache"] = Options::instance().blockCache;
+    build["jit"] = Options::instance().jit;
+#ifdef CPU_PROFILING
+    build["profiling"] = true;
+#else
+    build["profiling"] = false;
+#endif
+    QJsonObject report;
+    report["format"] = 1;
+    report["build"] = build;
+    report["benchmarks"] = results;
+    QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    QFile file(path);
+    bool opened;
+    if(path == "-"){
+        opened = file.open(stdout, QIODevice::WriteOnly);
+    }
+    else{
+        opened = file.open(QIODevice::WriteOnly);
+    }
+    if(!opened || file.write(json) != json.size()){
+        qWarning("Failed to write the benchmark results to %s", qPrintable(path));
+        return 1;
+    }
+    return 0;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Benchmark::addResult(const QString &name, const QString &unit, ...)
+    ** Description: Records a benchmark by the median and minimum of its samples. The median is
+        the number to track across commits, the minimum shows how much of it is noise.
+**************************************************************************************************/
+void Benchmark::addResult(const QString &name, const QString &unit, QVector<double> samples){
+    std::sort(samples.begin(), samples.end());
+    double median = samples[samples.size() / 2];
+
+    QJsonObject result;
+    result["name"] = name;
+    result["unit"] = unit;
+    result["median"] = median;
+    result["min"] = samples.first();
+    result["samples"] = samples.size();
+    results.append(result);
+
+    QTextStream(stderr) << QString("%1 %2 %3 (min %4)\n")
+                           .arg(name, -28).arg(median, 12, 'f', 1).arg(unit).arg(samples.first(), 0, 'f', 1);
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Benchmark::opcodeFamilies()
+    ** Description: Times each family of opcode handlers through Cpu::emulateInstruction, the path
+        the emulator uses. Each family's instructions are laid out in a loop that keeps its
+        registers and memory accesses in RAM, and BENCHMARK_OPCODE_RUNS instructions of it are
+        timed BENCHMARK_SAMPLES times. Results are in nanoseconds per instruction.
+**************************************************************************************************/
+void Benchmark::opcodeFamilies(){
+    for(const OpcodeFamily &family : OPCODE_FAMILIES){
+        Cpu cpu;
+        uint16_t address = FAMILY_CODE;
+        while(address + family.length <= FAMILY_CODE + FAMILY_CODE_SIZE){
+            for(int i = 0; i < family.length; ++i){
+                cpu.memory[address + i] = family.code[i];
+            }
+            if(family.jumpsToNext){
+                for(int i = 0; i < family.length; i += 3){
+                    uint16_t next = address + i + 3;
+                    cpu.memory[address + i + 1] = next & 0xFF;
+                    cpu.memory[address + i + 2] = next >> 8;
+                }
+            }
+            address += family.length;
+        }
+        cpu.memory[address] = 0xC3;                     //jmp FAMILY_CODE
+        cpu.memory[address + 1] = FAMILY_CODE & 0xFF;
+        cpu.memory[address + 2] = FAMILY_CODE >> 8;
+        cpu.memory[FAMILY_SUBROUTINE] = 0xC9;           //ret
+
+        QVector<double> samples;
+        for(int sample = 0; sample < BENCHMARK_SAMPLES; ++sample){
+            cpu.registers.pc = FAMILY_CODE;
+            cpu.registers.bc = 0x3100;
+            cpu.registers.de = 0x3200;
+            cpu.registers.hl = 0x3300;
+            cpu.registers.sp = 0x3F00;
+
+            QElapsedTimer timer;
+            timer.start();
+            for(int i = 0; i < BENCHMARK_OPCODE_RUNS; ++i){
+                cpu.emulateInstruction();
+            }
+            samples.append((double)timer.nsecsElapsed() / BENCHMARK_OPCODE_RUNS);
+        }
+        addResult(QString("opcodes/%1").arg(family.name), "ns/instruction", samples);
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Benchmark::frames()
+    ** Description: Times the game itself. The attract mode is run for BENCHMARK_WARMUP_FRAMES so
+        the screen has something on it, then BENCHMARK_FRAMES are timed one by one, followed by
+        paintScreen on the current video RAM and saving and loading snapshots. Frames run as fast
+        as the host allows rather than at 60 per second. Unless the Jit is on, the same frames
+        are timed again from the block cache, so the two dispatch loops can be compared.
+**************************************************************************************************/
+void Benchmark::frames(){
+    Emulator emulator;
+    if(!emulator.loadRom()){
+        qWarning("Failed to open the rom file, the frame benchmarks were not run");
+        return;
+    }
+    for(int frame = 0; frame < BENCHMARK_WARMUP_FRAMES; ++frame){
+        emulator.emulateFrame();
+    }
+    QByteArray warm = emulator.saveSnapshot();
+
+    QElapsedTimer timer;
+    QVector<double> samples;
+    QVector<double> frameCycles;
+    for(int frame = 0; frame < BENCHMARK_FRAMES; ++frame){
+        timer.start();
+        emulator.emulateFrame();
+        samples.append(timer.nsecsElapsed() / 1000.0);
+        frameCycles.append(emulator.frameTiming.last);
+    }
+    addResult("frame/attract_mode", "us", samples);
+    addResult("frame/emulated_cycles", "cycles", frameCycles);
+
+    if(!Options::instance().jit){
+        emulator.loadSnapshot(warm);
+        emulator.setBlockCache(true);
+        samples.clear();
+        for(int frame = 0; frame < BENCHMARK_FRAMES; ++frame){
+            timer.start();
+            emulator.emulateFrame();
+            samples.append(timer.nsecsElapsed() / 1000.0);
+        }
+        addResult("frame/attract_mode_blocks", "us", samples);
+        emulator.setBlockCache(Options::instance().blockCache);
+    }
+
+    samples.clear();
+    for(int i = 0; i < BENCHMARK_REPEATS; ++i){
+        timer.start();
+        emulator.paintScreen();
+        samples.append(timer.nsecsElapsed() / 1000.0);
+    }
+    addResult("render/paint_screen", "us", samples);
+
+    QByteArray snapshot;
+    samples.clear();
+    for(int i = 0; i < BENCHMARK_REPEATS; ++i){
+        timer.start();
+        snapshot = emulator.saveSnapshot();
+        samples.append(timer.nsecsElapsed() / 1000.0);
+    }
+    addResult("snapshot/save", "us", samples);
+
+    samples.clear();
+    for(int i = 0; i < BENCHMARK_REPEATS; ++i){
+        timer.start();
+        emulator.loadSnapshot(snapshot);
+        samples.append(timer.nsecsElapsed() / 1000.0);
+    }
+    addResult("snapshot/load", "us", samples);
+}
+
+//times creating an Emulator and loading the rom into it, what every new instance pays
+void Benchmark::startup(){
+    QElapsedTimer timer;
+    QVector<double> samples;
+    for(int i = 0; i < BENCHMARK_STARTUPS; ++i){
+        timer.start();
+        Emulator *emulator = new Emulator;
+        bool loaded = emulator->loadRom();
+        samples.append(timer.nsecsElapsed() / 1000.0);
+        delete emulator;
+        if(!loaded){
+            return;
+        }
+    }
+    addResult("startup/emulator", "us", samples);
+}
@@ -0,0 +1,37 @@
+/**************************************************************************************************
+    ** File Name: benchmark.h
+    ** Description: This file contains the Class declaration for the Benchmark class, which times
+        the parts of the emulator that performance work touches: each family of opcode handlers,
+        whole frames of the attract mode, paintScreen, snapshot saving and loading, and starting
+        up a new Emulator. Results are written as JSON with a fixed layout and sorted keys so runs
+        from different commits can be compared line by line.
+**************************************************************************************************/
+#include <QJsonArray>
+#include <QString>
+#include <QVector>
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+const int BENCHMARK_SAMPLES = 9;                //timed repeats of each opcode family
+const int BENCHMARK_OPCODE_RUNS = 1000000;      //instructions per opcode family sample
+const int BENCHMARK_WARMUP_FRAMES = 120;        //frames run before the attract mode is timed
+const int BENCHMARK_FRAMES = 600;               //frames of attract mode timed one by one
+const int BENCHMARK_REPEATS = 200;              //paints and snapshot saves and loads timed
+const int BENCHMARK_STARTUPS = 20;              //Emulators created and given the rom
+
+class Benchmark
+{
+public:
+    int run(const QString &path);               //runs every benchmark and writes the JSON to path
+
+private:
+    void opcodeFamilies();
+    void frames();
+    void startup();
+    void addResult(const QString &name, const QString &unit, QVector<double> samples);
+
+    QJsonArray results;
+};
+
+#endif // BENCHMARK_H
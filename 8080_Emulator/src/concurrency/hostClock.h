@@ -0,0 +1,19 @@
+/**************************************************************************************************
+    ** File Name: hostClock.h
+    ** Description: This file contains hostNanoseconds, the monotonic clock that threads stamp
+        the things they pass each other with, so the times taken on the gui thread and on the
+        emulation thread can be compared.
+**************************************************************************************************/
+#include <chrono>
+#include <stdint.h>
+
+#ifndef HOSTCLOCK_H
+#define HOSTCLOCK_H
+
+//nanoseconds on a clock that never goes backwards and is the same on every thread
+inline int64_t hostNanoseconds(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // HOSTCLOCK_H
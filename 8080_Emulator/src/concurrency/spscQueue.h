@@ -0,0 +1,57 @@
+/**************************************************************************************************
+    ** File Name: spscQueue.h
+    ** Description: This file contains the SpscQueue class template, a fixed size lock-free queue
+        for passing small items from exactly one producer thread to exactly one consumer
+        thread. Neither side ever blocks: push fails when the queue is full and pop fails when
+        it is empty, so the emulation thread can hand work to another thread without waiting.
+**************************************************************************************************/
+#include <atomic>
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+const int CACHE_LINE_SIZE = 64;                 //bytes the queue's counters are kept apart by
+
+template<typename T, unsigned capacity>
+class SpscQueue
+{
+    static_assert((capacity & (capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    //adds item at the tail, called only by the producer, false if the queue is full
+    bool push(const T &item){
+        unsigned currentTail = tail.load(std::memory_order_relaxed);
+        if(currentTail - head.load(std::memory_order_acquire) == capacity){
+            return false;
+        }
+        items[currentTail & (capacity - 1)] = item;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //takes the item at the head, called only by the consumer, false if the queue is empty
+    bool pop(T &item){
+        unsigned currentHead = head.load(std::memory_order_relaxed);
+        if(currentHead == tail.load(std::memory_order_acquire)){
+            return false;
+        }
+        item = items[currentHead & (capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    T items[capacity];
+    //the counters only ever grow and wrap together, each is written by one side only and kept
+    //on its own cache line so the two threads do not fight over it. They are padded apart
+    //rather than aligned, as new does not honour extended alignment before C++17
+    char itemsPadding[CACHE_LINE_SIZE];
+    std::atomic<unsigned> head;                 //next item to pop, written by the consumer
+    char headPadding[CACHE_LINE_SIZE - sizeof(std::atomic<unsigned>)];
+    std::atomic<unsigned> tail;                 //next free slot, written by the producer
+    char tailPadding[CACHE_LINE_SIZE - sizeof(std::atomic<unsigned>)];
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,148 @@
+/**************************************************************************************************
+    ** File Name: cpmRunner.cpp
+    ** Description: Contains the member function definitions for the CpmRunner class.
+**************************************************************************************************/
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include "cpmRunner.h"
+#include "../options/options.h"
+
+
+/**************************************************************************************************
+    ** Function Name: CpmRunner::CpmRunner()
+    ** Description: The default constructor for the CpmRunner class. The Cpu is run the way the
+        command line asks for, through the Jit, the block cache or one instruction at a time, so
+        each build and engine can be checked and timed.
+**************************************************************************************************/
+CpmRunner::CpmRunner() : jit(&cpu)
+{
+    cycles = 0;
+    elapsed = 0;
+    cpu.setStrictTiming(Options::instance().strictTiming);
+    cpu.blockCacheEnabled = Options::instance().blockCache;
+    if(Options::instance().jit){
+        jit.verify = Options::instance().jitVerify;
+        jit.start();
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: int CpmRunner::runAll(const QStringList &programs)
+    ** Description: Runs each program on a fresh Cpu and prints a PASS or FAIL line for it with
+        the cycles it ran and the wall clock time it took. The effective clock rate is printed
+        as well, which makes 8080EXM a good throughput benchmark for comparing builds. Returns
+        0 if every program passed and 1 otherwise, for use as the program's exit code.
+**************************************************************************************************/
+int CpmRunner::runAll(const QStringList &programs){
+    QTextStream out(stdout);
+    int failures = 0;
+    for(const QString &program : programs){
+        CpmRunner runner;
+        bool passed = runner.run(program);
+        if(!runner.output.isEmpty() && !runner.output.endsWith('\n')){
+            out << '\n';
+        }
+        double seconds = runner.elapsed / 1000000000.0;
+        double megahertz = seconds > 0 ? runner.cycles / seconds / 1000000.0 : 0.0;
+        out << (passed ? "PASS  " : "FAIL  ") << program
+            << QString("  %1 cycles  %2 s  %3 MHz\n")
+               .arg(runner.cycles)
+               .arg(seconds, 0, 'f', 3)
+               .arg(megahertz, 0, 'f', 1);
+        out.flush();
+        if(!passed){
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+//runs the next instruction or block the same way the Emulator would
+int CpmRunner::step(){
+    if(jit.enabled){
+        return jit.run();
+    }
+    if(cpu.blockCacheEnabled){
+        return cpu.emulateBlock();
+    }
+    return cpu.emulateInstruction();
+}
+
+//handles the BDOS call being made, only the console output calls the diagnostics use are known
+void CpmRunner::bdosCall(){
+    QTextStream out(stdout);
+    if(cpu.registers.c == 2){
+        QChar character(cpu.registers.e);
+        output += character;
+        out << character;
+    }
+    else if(cpu.registers.c == 9){
+        for(uint16_t address = cpu.registers.de; cpu.memory[address] != '$'; ++address){
+            QChar character(cpu.memory[address]);
+            output += character;
+            out << character;
+            if(address == 0xFFFF){
+                break;
+            }
+        }
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool CpmRunner::run(const QString &path)
+    ** Description: Loads the program at path into 0x100 and runs it until it jumps to 0 or
+        reaches a HLT, handling BDOS calls whenever the pc lands on address 5. The BDOS entry
+        jumps to a RET so the call returns the way it would under CP/M, and the word at 6 holds
+        the top of usable memory for programs that place their stack there. A program passes
+        if it finishes without printing ERROR or FAIL, which is how the diagnostics report. The
+        Cpu is told not to exit on a HLT, so one reached partway through a block under the block
+        cache or the Jit stops the program and fails it like any other.
+**************************************************************************************************/
+bool CpmRunner::run(const QString &path){
+    QFile program(path);
+    if(!program.open(QIODevice::ReadOnly)){
+        qWarning("Could not open %s", qPrintable(path));
+        return false;
+    }
+    QByteArray data = program.readAll();
+    if(data.size() > CPM_BDOS_RETURN - CPM_PROGRAM_START){
+        qWarning("%s does not fit below the BDOS", qPrintable(path));
+        return false;
+    }
+    for(int i = 0; i < data.size(); i++){
+        cpu.memory[CPM_PROGRAM_START + i] = data.at(i);
+    }
+
+    cpu.memory[0x0000] = 0x76;                          //warm boot, never run
+    cpu.memory[CPM_BDOS_ENTRY] = 0xC3;                  //jmp CPM_BDOS_RETURN
+    cpu.memory[CPM_BDOS_ENTRY + 1] = CPM_BDOS_RETURN & 0xFF;
+    cpu.memory[CPM_BDOS_ENTRY + 2] = CPM_BDOS_RETURN >> 8;
+    cpu.memory[CPM_BDOS_RETURN] = 0xC9;                 //ret
+    cpu.registers.pc = CPM_PROGRAM_START;
+    cpu.registers.sp = CPM_BDOS_RETURN;
+    cpu.exitOnHalt = false;
+    cpu.halted = false;
+
+    QElapsedTimer timer;
+    timer.start();
+    while(true){
+        uint16_t pc = cpu.registers.pc;
+        if(pc == 0x0000 || cpu.halted){
+            break;
+        }
+        if(pc == CPM_BDOS_ENTRY){
+            bdosCall();
+        }
+        cycles += step();
+    }
+    elapsed = timer.nsecsElapsed();
+
+    bool finished = cpu.registers.pc == 0x0000;
+    return finished && !output.contains("ERROR", Qt::CaseInsensitive)
+            && !output.contains("FAIL", Qt::CaseInsensitive);
+}
@@ -0,0 +1,42 @@
+/**************************************************************************************************
+    ** File Name: cpmRunner.h
+    ** Description: This file contains the Class declaration for the CpmRunner class, which runs
+        CP/M .COM programs such as the classic 8080 diagnostics (CPUDIAG, TST8080, 8080PRE and
+        8080EXM) on the emulator's Cpu. The program is loaded at 0x100 and the only parts of CP/M
+        it gets are the BDOS console calls at address 5: 2 prints the character in E and 9 prints
+        the '$' terminated string at DE. Jumping back to 0 ends the program.
+**************************************************************************************************/
+#include <QString>
+#include <QStringList>
+
+#include "../cpu/cpu.h"
+#include "../jit/jit.h"
+
+#ifndef CPMRUNNER_H
+#define CPMRUNNER_H
+
+const uint16_t CPM_PROGRAM_START = 0x100;       //where CP/M loads a .COM program
+const uint16_t CPM_BDOS_ENTRY = 0x0005;         //programs call here for operating system services
+const uint16_t CPM_BDOS_RETURN = 0xFE00;        //a lone RET standing in for the BDOS
+
+class CpmRunner
+{
+public:
+    CpmRunner();                                //default constructor
+
+    static int runAll(const QStringList &programs);
+    bool run(const QString &path);              //runs one program, true if it passed
+
+    QString output;                             //everything the program printed
+    uint64_t cycles;
+    qint64 elapsed;                             //wall clock nanoseconds
+
+private:
+    void bdosCall();
+    int step();
+
+    Cpu cpu;
+    Jit jit;
+};
+
+#endif // CPMRUNNER_H
@@ -0,0 +1,188 @@
+/**************************************************************************************************
+    ** File Name: blockCache.cpp
+    ** Description: Contains the member function definitions for the BlockCache class.
+**************************************************************************************************/
+#include <string.h>
+
+#include "blockCache.h"
+
+//number of bytes taken up by each opcode, including its immediate operands
+static const uint8_t OPCODE_LENGTHS[256] = {
+    1, 3, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     //0x00
+    1, 3, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 2, 1,     //0x10
+    1, 3, 3, 1, 1, 1, 2, 1, 1, 1, 3, 1, 1, 1, 2, 1,     //0x20
+    1, 3, 3, 1, 1, 1, 2, 1, 1, 1, 3, 1, 1, 1, 2, 1,     //0x30
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     //0x40
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     //0x50
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     //0x60
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     //0x70
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     //0x80
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     //0x90
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     //0xA0
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     //0xB0
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 3, 3, 3, 2, 1,     //0xC0
+    1, 1, 3, 2, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,     //0xD0
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 3, 2, 1,     //0xE0
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 3, 2, 1      //0xF0
+};
+
+/**************************************************************************************************
+    ** Function Name: BlockCache::BlockCache()
+    ** Description: The default constructor for an object of the BlockCache class, allocates an
+        empty slot for every address and clears the code page counts.
+**************************************************************************************************/
+BlockCache::BlockCache()
+{
+    blocks = new Block*[0x10000];
+    codePages = new uint16_t[0x10000 / CODE_PAGE_SIZE];
+    memset(blocks, 0, sizeof(Block*) * 0x10000);
+    memset(codePages, 0, sizeof(uint16_t) * (0x10000 / CODE_PAGE_SIZE));
+    generation = 0;
+    cycleTable = CYCLES_8080;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: BlockCache::~BlockCache()
+    ** Description: Destructor for the BlockCache class, frees every block and the lookup tables.
+**************************************************************************************************/
+BlockCache::~BlockCache(){
+    clear();
+    delete[] blocks;
+    delete[] codePages;
+}
+
+
+//returns true for opcodes that can move the pc anywhere other than the next instruction
+bool BlockCache::endsBlock(uint8_t opcode){
+    if(opcode == 0x76 || opcode == 0xE9){      //hlt and pchl
+        return true;
+    }
+    if((opcode & 0xC0) != 0xC0){
+        return false;
+    }
+    switch(opcode & 0x07){
+    case 0x00:                                  //conditional returns
+    case 0x02:                                  //conditional jumps
+    case 0x04:                                  //conditional calls
+    case 0x07:                                  //rst
+        return true;
+    case 0x01:                                  //ret and its alias
+        return opcode == 0xC9 || opcode == 0xD9;
+    case 0x03:                                  //jmp and its alias
+        return opcode == 0xC3 || opcode == 0xCB;
+    case 0x05:                                  //call and its aliases
+        return (opcode & 0x08) != 0;
+    }
+    return false;
+}
+
+//returns the number of bytes taken up by an opcode and its immediate operands
+int BlockCache::length(uint8_t opcode){
+    return OPCODE_LENGTHS[opcode];
+}
+
+
+/**************************************************************************************************
+    ** Function Name: BlockCache::Block* BlockCache::build(const uint8_t *memory, uint16_t address)
+    ** Description: Decodes instructions starting at address until a branch is reached, the block
+        is full, or the next instruction would wrap past the end of memory. The opcode, operands
+        and running cycle count of every instruction are stored so the block can be replayed, and
+        each page the block covers is marked as holding code.
+**************************************************************************************************/
+BlockCache::Block* BlockCache::build(const uint8_t *memory, uint16_t address){
+    Block *block = new Block;
+    block->start = address;
+    block->opCount = 0;
+    block->executions = 0;
+    block->nativeCode = nullptr;
+    block->nativeTried = false;
+
+    uint32_t pc = address;
+    int cycles = 0;
+    while(block->opCount < MAX_BLOCK_OPS){
+        uint8_t opcode = memory[pc];
+        uint8_t length = OPCODE_LENGTHS[opcode];
+        if(block->opCount > 0 && pc + length > 0x10000){
+            break;
+        }
+
+        DecodedOp &op = block->ops[block->opCount++];
+        op.opcode = opcode;
+        op.length = length;
+        op.low = memory[(uint16_t)(pc + 1)];
+        op.high = memory[(uint16_t)(pc + 2)];
+        cycles += cycleTable[opcode];
+        op.cycleSum = cycles;
+        pc += length;
+
+        if(endsBlock(opcode) || pc > 0xFFFF){
+            break;
+        }
+    }
+    block->end = pc;
+    block->bodyCycles = block->opCount > 1 ? block->ops[block->opCount - 2].cycleSum : 0;
+
+    //mark every page the block's bytes live on
+    for(uint32_t page = address / CODE_PAGE_SIZE; page <= (pc - 1) / CODE_PAGE_SIZE; ++page){
+        codePages[page]++;
+    }
+    blocks[address] = block;
+    return block;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void BlockCache::invalidate(uint16_t address)
+    ** Description: Drops every block whose bytes include address. A block holds at most
+        MAX_BLOCK_OPS instructions of up to 3 bytes, so only blocks starting that far before the
+        written address can reach it.
+**************************************************************************************************/
+void BlockCache::invalidate(uint16_t address){
+    int first = address - MAX_BLOCK_OPS * 3;
+    if(first < 0){
+        first = 0;
+    }
+    for(int start = first; start <= address; ++start){
+        Block *block = blocks[start];
+        if(block != nullptr && address < block->end){
+            release(start);
+        }
+    }
+}
+
+//drops every block in the cache
+void BlockCache::clear(){
+    for(int start = 0; start < 0x10000; ++start){
+        if(blocks[start] != nullptr){
+            release(start);
+        }
+    }
+}
+
+//clears the translated code of every block, used when the Jit throws its code buffer away
+void BlockCache::dropNativeCode(){
+    for(int start = 0; start < 0x10000; ++start){
+        if(blocks[start] != nullptr){
+            blocks[start]->nativeCode = nullptr;
+            blocks[start]->nativeTried = false;
+            blocks[start]->executions = 0;
+        }
+    }
+}
+
+//gives the Jit read access to the code page counts so native stores can check them
+const uint16_t* BlockCache::codePageCounts(){
+    return codePages;
+}
+
+//frees the block starting at address and removes it from the code page counts
+void BlockCache::release(uint16_t address){
+    Block *block = blocks[address];
+    for(uint32_t page = address / CODE_PAGE_SIZE; page <= (block->end - 1) / CODE_PAGE_SIZE; ++page){
+        codePages[page]--;
+    }
+    blocks[address] = nullptr;
+    delete block;
+    generation++;
+}
@@ -0,0 +1,77 @@
+/**************************************************************************************************
+    ** File Name: blockCache.h
+    ** Description: This file contains the Class declaration for the BlockCache class. The cache
+        holds pre-decoded basic blocks of 8080 code keyed by their starting address, so the Cpu
+        can run a whole run of straight-line instructions up to the next branch without fetching
+        and decoding each opcode again. Blocks are dropped when a write lands on their code.
+**************************************************************************************************/
+#include <stdint.h>
+
+#include "cycles.h"
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+const int MAX_BLOCK_OPS = 32;                   //longest run of instructions decoded into a block
+const int CODE_PAGE_SIZE = 0x100;               //granularity used to track pages holding code
+
+class BlockCache
+{
+public:
+    //a single instruction as it was decoded when the block was built
+    struct DecodedOp{
+        uint8_t opcode;
+        uint8_t length;                         //number of bytes the instruction takes up
+        uint8_t low;                            //first immediate byte, if any
+        uint8_t high;                           //second immediate byte, if any, right after low
+                                                //so the Cpu can read both through &low
+        int cycleSum;                           //cycles of this op and every op before it
+    };
+
+    //a straight-line run of instructions ending in a branch or at MAX_BLOCK_OPS
+    struct Block{
+        uint16_t start;                         //address of the first instruction
+        uint32_t end;                           //address one past the last instruction
+        int opCount;
+        int bodyCycles;                         //cycles of every op except the last one
+        DecodedOp ops[MAX_BLOCK_OPS];
+
+        uint32_t executions;                    //times the block has been entered
+        void *nativeCode;                       //translated code from the Jit, if any
+        bool nativeTried;                       //set once the Jit has looked at the block
+    };
+
+    BlockCache();                               //default constructor
+    ~BlockCache();                              //destructor
+
+    //returns the block starting at address, or nullptr if it has not been built yet
+    //kept inline as it is called before every block the Cpu runs
+    Block* lookup(uint16_t address){
+        return blocks[address];
+    }
+
+    //checks if any block covers the page holding address, called on every memory write
+    bool isCodePage(uint16_t address){
+        return codePages[address / CODE_PAGE_SIZE] != 0;
+    }
+
+    Block* build(const uint8_t *memory, uint16_t address);
+    void invalidate(uint16_t address);          //drops every block that covers address
+    void clear();                               //drops every block
+    void dropNativeCode();                      //forgets the Jit's code for every block
+    const uint16_t* codePageCounts();           //number of blocks on each page, for the Jit
+
+    uint32_t generation;                        //bumped whenever blocks are dropped
+    const uint8_t *cycleTable;                  //cycles charged per opcode, set by the Cpu
+
+    static bool endsBlock(uint8_t opcode);      //checks if an opcode transfers control
+    static int length(uint8_t opcode);          //bytes an opcode takes up with its operands
+
+private:
+    void release(uint16_t address);
+
+    Block **blocks;                             //one slot per address in the 64K space
+    uint16_t *codePages;                        //number of blocks touching each page
+};
+
+#endif // BLOCKCACHE_H
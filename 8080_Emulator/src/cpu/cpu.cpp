@@ -2,6 +2,8 @@
     ** File Name: cpu.cpp
     ** Description: Contains the member function definitions for the Cpu Class.
 **************************************************************************************************/
+#include <QDebug>
+
 #include "cpu.h"
 
 
@@ -15,22 +17,31 @@ Cpu::Cpu()
     memset(&registers, 0, sizeof(State8080Registers));
 
 
-    //initializing input values
-    input0 = 0b01110000;
-    input1 = 0b00001000;
-    input2 = 0;
-    input3 = 0;
+    //initializing input values, and the ports they are read on, to the Space Invaders board's
+    input0 = Machine::standard().inputDefaults[0];
+    input1 = Machine::standard().inputDefaults[1];
+    input2 = Machine::standard().inputDefaults[2];
+    setPorts(Machine::standard().ports);
 
     //initialize output values
-    output2 = 0;
     output3 = 0;
-    output4 = 0;
     output5 = 0;
     output6 = 0;
 
     enableInterrupts = false;       //disabling interrupts to being
     twoPlayer = false;              //setting to 1 player
-    memory = new uint8_t[0x4000];    //allocate memory for the RAM
+    blockCacheEnabled = false;      //single step unless --block-cache asks for blocks
+    exitOnHalt = true;              //the game never halts, a HLT means it has gone wrong
+    halted = false;
+    setStrictTiming(false);         //keep the timing the emulator has always used
+
+    //allocate the full 64K address space so any 16 bit address can be decoded safely
+    memory = new uint8_t[0x10000];
+    memset(memory, 0, 0x10000);
+    operands = &memory[1];
+#ifdef CPU_PROFILING
+    profiler.memory = memory;
+#endif
 }
 
 
@@ -39,7 +50,93 @@ Cpu::Cpu()
     ** Description: Deconstructor for the Cpu class, frees up the memory allocated for the RAM.
 **************************************************************************************************/
 Cpu::~Cpu(){
-    delete memory;
+    delete[] memory;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Cpu::setStrictTiming(bool strict)
+    ** Description: Picks the cycle table instructions are charged from. Strict timing uses the
+        data sheet counts in CYCLES_8080, otherwise the few opcodes in LEGACY_CYCLE_DIFFERENCES
+        keep the counts the emulator has always charged. Cached blocks hold running cycle sums,
+        so they are dropped and rebuilt from the new table.
+**************************************************************************************************/
+void Cpu::setStrictTiming(bool strict){
+    strictTiming = strict;
+    memcpy(cycleTable, CYCLES_8080, sizeof(cycleTable));
+    if(!strict){
+        for(const CycleDifference &difference : LEGACY_CYCLE_DIFFERENCES){
+            cycleTable[difference.opcode] = difference.cycles;
+        }
+    }
+    blockCache.cycleTable = cycleTable;
+    blockCache.clear();
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Cpu::writeMemory(uint16_t address, uint8_t value)
+    ** Description: Stores value at address. Every instruction that writes to memory goes through
+        here so blocks decoded from the written bytes can be dropped from the block cache.
+**************************************************************************************************/
+void Cpu::writeMemory(uint16_t address, uint8_t value){
+    memory[address] = value;
+    if(blockCache.isCodePage(address)){
+        blockCache.invalidate(address);
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Cpu::setPorts(const PortMap &ports)
+    ** Description: Wires the io bus up the way a board's PortMap says: the input latches, sound
+        latches and watchdog to the Cpu's own registers and the shift register's ports to
+        shifter. Ports the map leaves out, or gives as -1, are not connected.
+**************************************************************************************************/
+void Cpu::setPorts(const PortMap &ports){
+    io.clear();
+    io.attachInput(ports.inputs[0], this, INPUT0);
+    io.attachInput(ports.inputs[1], this, INPUT1);
+    io.attachInput(ports.inputs[2], this, INPUT2);
+    io.attachInput(ports.shiftResult, &shifter, ShiftRegister::RESULT);
+    io.attachOutput(ports.shiftAmount, &shifter, ShiftRegister::AMOUNT);
+    io.attachOutput(ports.shiftData, &shifter, ShiftRegister::DATA);
+    io.attachOutput(ports.sounds[0], this, SOUND1);
+    io.attachOutput(ports.sounds[1], this, SOUND2);
+    io.attachOutput(ports.watchdog, this, WATCHDOG);
+}
+
+//reads one of the input latches, for in through the io bus
+uint8_t Cpu::read(int reg){
+    switch(reg){
+    case INPUT0:
+        return input0;
+    case INPUT1:
+        return input1;
+    default:
+        return input2;
+    }
+}
+
+//writes a sound latch or the watchdog, for out through the io bus
+void Cpu::write(int reg, uint8_t value){
+    switch(reg){
+    case SOUND1:                            //play sounds
+        if(value != output3){
+            output3 = value;
+            emit writeOnPort3(output3);     //emits signal that the sounds on port 3 changed
+        }
+        break;
+    case SOUND2:                            //play sounds
+        if(value != output5){
+            output5 = value;
+            emit writeOnPort5(output5);     //emits signal that the sounds on port 5 changed
+        }
+        break;
+    case WATCHDOG:                          //resets watchdog circuit
+        output6 = value;
+        break;
+    }
 }
 
 
@@ -152,7 +249,7 @@ int Cpu::ana(uint8_t secondRegister){
 
 //ana function but for the special "M Register"
 int Cpu::anaM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
+    uint16_t offset = registers.hl;
     ana(memory[offset]);
     return 7;
 }
@@ -168,7 +265,7 @@ int Cpu::xra(uint8_t secondRegister){
 
 //xra function for the special "M Register"
 int Cpu::xraM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
+    uint16_t offset = registers.hl;
     xra(memory[offset]);
     return 7;
 }
@@ -184,7 +281,7 @@ int Cpu::ora(uint8_t secondRegister){
 
 //ora function for the special "M Register"
 int Cpu::oraM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
+    uint16_t offset = registers.hl;
     ora(memory[offset]);
     return 7;
 }
@@ -201,7 +298,7 @@ int Cpu::cmp(uint8_t secondRegister){
 
 //cmp function for special "M Register"
 int Cpu::cmpM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
+    uint16_t offset = registers.hl;
     cmp(memory[offset]);
     return 7;
 }
@@ -273,7 +370,7 @@ int Cpu::rar(){
 
 //special ana function with an immediate value
 int Cpu::ani(){
-    ana(memory[registers.pc+1]);
+    ana(operand8());
     registers.pc++;
     return 7;
 }
@@ -287,21 +384,21 @@ int Cpu::cma(){
 
 //special xri function with an immediate value
 int Cpu::xri(){
-    xra(memory[registers.pc+1]);
+    xra(operand8());
     registers.pc++;
     return 7;
 }
 
 //special ori function with an immediate value
 int Cpu::ori(){
-    ora(memory[registers.pc+1]);
+    ora(operand8());
     registers.pc++;
     return 7;
 }
 
 //special compare with an immediate value
 int Cpu::cpi(){
-    cmp(memory[registers.pc+1]);
+    cmp(operand8());
     registers.pc++;
     return 7;
 }
@@ -329,15 +426,15 @@ int Cpu::mov(uint8_t &destination, uint8_t source){
 
 //mov function for moving values into the special "M Register"
 int Cpu::movToM(uint8_t source){
-    uint16_t offset = (registers.h << 8) | registers.l;
-    memory[offset] = source;
+    uint16_t offset = registers.hl;
+    writeMemory(offset, source);
     registers.pc++;
     return 7;
 }
 
 //mov function for moving value in the "M Register" into another register
 int Cpu::movMTo(uint8_t &destination){
-    uint16_t offset = (registers.h << 8) | registers.l;
+    uint16_t offset = registers.hl;
     destination = memory[offset];
     registers.pc++;
     return 7;
@@ -345,103 +442,85 @@ int Cpu::movMTo(uint8_t &destination){
 
 //mov function for an immediate value
 int Cpu::mvi(uint8_t &destination){
-    destination = memory[registers.pc+1];
+    destination = operand8();
     registers.pc += 2;
     return 7;
 }
 
 //mvi function for the "M Register"
 int Cpu::mviM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
-    memory[offset] = memory[registers.pc+1];
+    uint16_t offset = registers.hl;
+    writeMemory(offset, operand8());
     registers.pc += 2;
     return 10;
 }
 
-//loads values from memory into two target registers
-int Cpu::lxi(uint8_t &nameRegister, uint8_t &nextRegister){
-    nextRegister = memory[registers.pc+1];
-    nameRegister = memory[registers.pc+2];
-    registers.pc += 3;
-    return 10;
-}
-
-//loads values from memory into sp
-int Cpu::lxiSP(){
-    uint8_t low = memory[registers.pc+1];
-    uint8_t high = memory[registers.pc+2];
-
-    registers.sp = (high << 8) | low;
+//loads the 16 bit immediate value into a register pair or sp
+int Cpu::lxi(uint16_t &registerPair){
+    registerPair = operand16();
     registers.pc += 3;
     return 10;
 }
 
-//loads the value of memory set at the offset of two registers values into a
-int Cpu::ldax(uint8_t nameRegister, uint8_t nextRegister){
-    uint16_t offset = (nameRegister << 8) | nextRegister;
-    registers.a = memory[offset];
+//loads the value of memory at the address held in a register pair into a
+int Cpu::ldax(uint16_t address){
+    registers.a = memory[address];
     registers.pc++;
     return 7;
 }
 
-//stores value held in a into memory
-int Cpu::stax(uint8_t nameRegister, uint8_t nextRegister){
-    uint16_t offset = (nameRegister << 8) | nextRegister;
-    memory[offset] = registers.a;
+//stores value held in a into memory at the address held in a register pair
+int Cpu::stax(uint16_t address){
+    writeMemory(address, registers.a);
     registers.pc++;
     return 7;
 }
 
 //loads value from memory into registers l and h
 int Cpu::lhld(){
-    uint16_t address = (memory[registers.pc+2] << 8) | memory[registers.pc+1];
+    uint16_t address = operand16();
     registers.l = memory[address];
-    registers.h = memory[address+1];
+    registers.h = memory[(uint16_t)(address + 1)];
     registers.pc += 3;
     return 16;
 }
 
 //stores values held in registers l and h into memory
 int Cpu::shld(){
-    uint16_t address = (memory[registers.pc+2] << 8) | memory[registers.pc+1];
-    memory[address] = registers.l;
-    memory[address+1] = registers.h;
+    uint16_t address = operand16();
+    writeMemory(address, registers.l);
+    writeMemory(address+1, registers.h);
     registers.pc += 3;
     return 16;
 }
 
 //stores a register value into memory
 int Cpu::sta(){
-    uint16_t offset = (memory[registers.pc+2] << 8) | memory[registers.pc+1];
-    memory[offset] = registers.a;
+    uint16_t offset = operand16();
+    writeMemory(offset, registers.a);
     registers.pc += 3;
     return 13;
 }
 
 //loads value from memory into a register
 int Cpu::lda(){
-    uint16_t offset = (memory[registers.pc+2] << 8) | memory[registers.pc+1];
+    uint16_t offset = operand16();
     registers.a = memory[offset];
     registers.pc += 3;
     return 13;
 }
 
-//sets pc to the summation of registers h and l
+//sets pc to the value of the HL pair
 int Cpu::pchl(){
-    uint16_t value = (registers.h << 8) | registers.l;
-    registers.pc = value;
+    registers.pc = registers.hl;
     return 5;
 }
 
-//swaps the values in d with h, and the values in e with l registers
+//swaps the values in the DE and HL pairs
 int Cpu::xchg(){
-    uint16_t registerDE = (registers.d << 8) | registers.e;
-    uint16_t registerHL = (registers.h << 8) | registers.l;
-
-    registers.d = getHighBits(registerHL);
-    registers.e = getLowBits(registerHL);
-    registers.h = getHighBits(registerDE);
-    registers.l = getLowBits(registerDE);
+    uint16_t registerDE = registers.de;
+    registers.de = registers.hl;
+    registers.hl = registerDE;
     registers.pc++;
     return 5;
 }
@@ -462,7 +541,10 @@ int Cpu::di(){
 
 //special instruction
 int Cpu::hlt(){
-    exit(0);
+    if(exitOnHalt){
+        exit(0);
+    }
+    halted = true;
     registers.pc++;
     return 4;
 }
@@ -477,11 +559,7 @@ int Cpu::nop(){
 
 // jumps the pc to the specified address
 int Cpu::jmp(){
-    uint8_t low = memory[registers.pc+1];
-    uint8_t high = memory[registers.pc+2];
-
-    uint16_t address = (high << 8) | low;
-    registers.pc = address;
+    registers.pc = operand16();
     return 10;
 }
 
@@ -498,19 +576,26 @@ int Cpu::conditionalJmp(bool condition){
 
 // pushes current PC location onto stack, and moves PC to specified call address
 int Cpu::call(){
+    //the address is read before the push, which may write over a cached block and free it
+    uint16_t value = operand16();
     uint16_t returnPC = registers.pc + 3;
-    memory[registers.sp-1] = getHighBits(returnPC);
-    memory[registers.sp-2] = getLowBits(returnPC);
+    writeMemory(registers.sp-1, getHighBits(returnPC));
+    writeMemory(registers.sp-2, getLowBits(returnPC));
     registers.sp -= 2;
 
-    uint16_t value = (memory[registers.pc+2] << 8) | memory[registers.pc+1];
     registers.pc = value;
+#ifdef CPU_PROFILING
+    profiler.enterCall(registers.pc, registers.sp);
+#endif
     return 17;
 }
 
 // CALL depending on whether certain flags are set
 int Cpu::conditionalCall(bool condition){
     if(condition){
+#ifdef CPU_PROFILING
+        profiler.recordExtraCycles(registers.pc, TAKEN_BRANCH_CYCLES);
+#endif
         call();
         return 17;
     }
@@ -525,21 +610,27 @@ int Cpu::rst(uint8_t resetNumber){
     uint8_t low = getLowBits(registers.pc);
     uint8_t high = getHighBits(registers.pc);
 
-    memory[registers.sp-1] = high;
-    memory[registers.sp-2] = low;
+    writeMemory(registers.sp-1, high);
+    writeMemory(registers.sp-2, low);
     registers.sp -= 2;
 
     uint16_t reset = resetNumber << 3;
     registers.pc = reset;
+#ifdef CPU_PROFILING
+    profiler.enterCall(registers.pc, registers.sp);
+#endif
 
     return 11;
 }
 
 // Pops the 16 bit return address off top of stack, move PC to that return address
 int Cpu::ret(){
-    uint16_t value = (memory[registers.sp+1] << 8) | memory[registers.sp];
+    uint16_t value = (memory[(uint16_t)(registers.sp + 1)] << 8) | memory[registers.sp];
     registers.pc = value;
     registers.sp += 2;
+#ifdef CPU_PROFILING
+    profiler.leaveCall(registers.sp);
+#endif
 
     return 10;
 }
@@ -547,6 +638,9 @@ int Cpu::ret(){
 // RET depending on whether certain flags are set
 int Cpu::conditionalRet(bool condition){
     if(condition){
+#ifdef CPU_PROFILING
+        profiler.recordExtraCycles(registers.pc, TAKEN_BRANCH_CYCLES);
+#endif
         ret();
         return 11;
     }
@@ -556,10 +650,10 @@ int Cpu::conditionalRet(bool condition){
     }
 }
 
-// Push a 16 bit int (from 2 registers) onto the stack
-int Cpu::push(uint8_t nameRegister, uint8_t nextRegister){
-    memory[registers.sp-1] = nameRegister;
-    memory[registers.sp-2] = nextRegister;
+// Push a 16 bit int (from a register pair) onto the stack
+int Cpu::push(uint16_t registerPair){
+    writeMemory(registers.sp-1, getHighBits(registerPair));
+    writeMemory(registers.sp-2, getLowBits(registerPair));
     registers.sp -= 2;
     registers.pc++;
     return 11;
@@ -567,17 +661,16 @@ int Cpu::push(uint8_t nameRegister, uint8_t nextRegister){
 
 // PUSH a 16 bit value PSW, representing the A register combined with the state of all flags, onto the stack
 int Cpu::pushPSW(){
-    memory[registers.sp-1] = registers.a;
-    memory[registers.sp-2] = flags.getRegisterValue();
+    writeMemory(registers.sp-1, registers.a);
+    writeMemory(registers.sp-2, flags.getRegisterValue());
     registers.sp -= 2;
     registers.pc++;
     return 11;
 }
 
-// Pop the 16 bit int off the stack into 2 registers
-int Cpu::pop(uint8_t &nameRegister, uint8_t &nextRegister){
-    nextRegister = memory[registers.sp];
-    nameRegister = memory[registers.sp+1];
+// Pop the 16 bit int off the stack into a register pair
+int Cpu::pop(uint16_t &registerPair){
+    registerPair = (memory[(uint16_t)(registers.sp + 1)] << 8) | memory[registers.sp];
     registers.sp += 2;
     registers.pc++;
     return 10;
@@ -586,7 +679,7 @@ int Cpu::pop(uint8_t &nameRegister, uint8_t &nextRegister){
 // POP the 16 bit int off the stack, updating the flags and the A register
 int Cpu::popPSW(){
     flags = Flags(memory[registers.sp]);
-    registers.a = memory[registers.sp+1];
+    registers.a = memory[(uint16_t)(registers.sp + 1)];
 
     registers.sp += 2;
     registers.pc++;
@@ -595,21 +688,18 @@ int Cpu::popPSW(){
 
 // Set the stack pointer to the memory address stored in the combined HL register
 int Cpu::sphl(){
-    registers.sp = (registers.h << 8) | registers.l;
+    registers.sp = registers.hl;
     registers.pc++;
     return 5;
 }
 
 // Exchange the 16 bit value stored in the combined HL register with the 16 bit value at the top of the stack
 int Cpu::xthl(){
-    uint8_t tempH = registers.h;
-    uint8_t tempL = registers.l;
+    uint16_t top = (memory[(uint16_t)(registers.sp + 1)] << 8) | memory[registers.sp];
 
-    registers.l = memory[registers.sp];
-    registers.h = memory[registers.sp+1];
-
-    memory[registers.sp] = tempL;
-    memory[registers.sp+1] = tempH;
+    writeMemory(registers.sp, registers.l);
+    writeMemory(registers.sp+1, registers.h);
+    registers.hl = top;
 
     registers.pc++;
     return 18;
@@ -617,38 +707,16 @@ int Cpu::xthl(){
 
 //arithmetic functions
 
-// Increments 16 bit int from 2 registers by 1
-int Cpu::inx(uint8_t &nameRegister, uint8_t &nextRegister){
-    uint16_t value = (nameRegister << 8) | nextRegister;
-    value++;
-    nameRegister = getHighBits(value);
-    nextRegister = getLowBits(value);
-
+// Increments a register pair or sp by 1
+int Cpu::inx(uint16_t &registerPair){
+    registerPair++;
     registers.pc++;
     return 5;
 }
 
-// Increments SP and PC
-int Cpu::inxSP(){
-    registers.sp++;
-    registers.pc++;
-    return 5;
-}
-
-// Decrements 16 bit int from 2 registers by 1
-int Cpu::dcx(uint8_t &nameRegister, uint8_t &nextRegister){
-    uint16_t value = (nameRegister << 8) | nextRegister;
-    value--;
-    nameRegister = getHighBits(value);
-    nextRegister = getLowBits(value);
-
-    registers.pc++;
-    return 5;
-}
-
-// Decrements SP and PC
-int Cpu::dcxSP(){
-    registers.sp--;
+// Decrements a register pair or sp by 1
+int Cpu::dcx(uint16_t &registerPair){
+    registerPair--;
     registers.pc++;
     return 5;
 }
@@ -663,9 +731,11 @@ int Cpu::inr(uint8_t &regName){
 
 // INR on the M register
 int Cpu::inrM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
-    return inr(memory[offset]);
-
+    uint16_t offset = registers.hl;
+    uint8_t value = memory[offset];
+    int cycles = inr(value);
+    writeMemory(offset, value);
+    return cycles;
 }
 
 // Decrements a register by 1, sets flags
@@ -677,34 +747,20 @@ int Cpu::dcr(uint8_t &regName){
 
 // DCR on the M register
 int Cpu::dcrM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
-    return dcr(memory[offset]);
+    uint16_t offset = registers.hl;
+    uint8_t value = memory[offset];
+    int cycles = dcr(value);
+    writeMemory(offset, value);
+    return cycles;
 }
 
-// Adds two 16 bit ints together (2 register + 2 register), sets carry flag
-int Cpu::dad(uint8_t nameRegister, uint8_t nextRegister){
-    uint16_t hl = (registers.h << 8) | registers.l;
-    uint16_t value = (nameRegister << 8) | nextRegister;
-    uint32_t sum = hl + value;
+// Adds a register pair or sp to the HL pair, sets carry flag
+int Cpu::dad(uint16_t registerPair){
+    uint32_t sum = registers.hl + registerPair;
     if(sum & 0x10000){
         flags.setBits(CARRY_BIT);
     }
-    registers.l = getLowBits((uint16_t)sum);
-    registers.h = getHighBits((uint16_t)sum);
-
-    registers.pc++;
-    return 10;
-}
-
-// Adds SP to the 16 bit int stored in HL
-int Cpu::dadSP(){
-    uint16_t hl = (registers.h << 8) | registers.l;
-    uint32_t result = registers.sp + hl;
-    if(result & 0x10000){
-        flags.setBits(CARRY_BIT);
-    }
-    registers.l = getLowBits((uint16_t)result);
-    registers.h = getHighBits((uint16_t)result);
+    registers.hl = sum;
 
     registers.pc++;
     return 10;
@@ -721,7 +777,7 @@ int Cpu::add(uint8_t regName){
 
 // ADD on the M register
 int Cpu::addM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
+    uint16_t offset = registers.hl;
     add(memory[offset]);
     return 7;
 }
@@ -737,7 +793,7 @@ int Cpu::adc(uint8_t regName){
 
 // ADC with the M register
 int Cpu::adcM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
+    uint16_t offset = registers.hl;
     adc(memory[offset]);
     return 7;
 }
@@ -754,9 +810,8 @@ int Cpu::sub(uint8_t regName){
 
 // SUB with the M register
 int Cpu::subM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
+    uint16_t offset = registers.hl;
     sub(memory[offset]);
-    registers.pc++;
     return 7;
 }
 
@@ -773,89 +828,50 @@ int Cpu::sbb(uint8_t regName){
 
 // SBB with the M register
 int Cpu::sbbM(){
-    uint16_t offset = (registers.h << 8) | registers.l;
+    uint16_t offset = registers.hl;
     sbb(memory[offset]);
     return 7;
 }
 
 // Adds an 8 bit int stored in memory to the A register
 int Cpu::adi(){
-    add(memory[registers.pc+1]);
+    add(operand8());
     registers.pc++;
     return 7;
 }
 
 // Subtracts an 8 bit int stored in memory from the A register
 int Cpu::sui(){
-    sub(memory[registers.pc+1]);
+    sub(operand8());
     registers.pc++;
     return 7;
 }
 
 // Adds an 8 bit int stored in memory and the carry flag to the A register
 int Cpu::aci(){
-    adc(memory[registers.pc+1]);
+    adc(operand8());
     registers.pc++;
     return 7;
 }
 
 // Subtracts an 8 bit int stored in memory and the carry flag from the A register
 int Cpu::sbi(){
-    sbb(memory[registers.pc+1]);
+    sbb(operand8());
     registers.pc++;
     return 7;
 }
 
-// special instruction to read from machine into A register, handles input
+// special instruction to read from machine into A register, handles input. Ports the board has
+// nothing on leave A as it was
 int Cpu::in(){
-    uint8_t inputValue = memory[registers.pc+1];
-    switch(inputValue){
-    case 1:
-        registers.a = input1;
-        break;
-    case 2:
-        registers.a = input2;
-        break;
-    case 3:
-        registers.a = input3;
-        break;
-    }
+    io.read(operand8(), registers.a);
     registers.pc += 2;
     return 10;
 }
 
 // special instruction to write to machine from A register for output
 int Cpu::out(){
-    uint8_t outputValue = memory[registers.pc+1];
-    switch(outputValue){
-    case 2:                                 //set bit shift amount
-        output2 = registers.a;
-        break;
-    case 3:                                 //play sounds
-        output3 = registers.a;
-        emit writeOnPort3(output3);         //emits signal that there was a write on port 3
-        break;
-    case 4:                                 //bit shift data in A register based on bit shift amount
-    {
-        output4 = registers.a;
-        uint8_t offset = output2 & 7;
-        uint16_t shiftReg = 0;
-        shiftReg >> 8;
-        uint16_t shiftIn = output4 << 8;
-        shiftReg = shiftReg | shiftIn;
-
-        uint16_t bitMask = 0xFF00 >> offset;
-        input3 = (shiftReg & bitMask) >> (8 - offset);
-        break;
-    }
-    case 5:                                 //play sounds
-        output5 = registers.a;
-        emit writeOnPort5(output5);         //emits signal that there was a write on port 5
-        break;
-    case 6:                                 //resets watchdog circuit
-        output6 = registers.a;
-        break;
-    }
+    io.write(operand8(), registers.a);
     registers.pc += 2;
     return 10;
 }
@@ -887,7 +903,39 @@ int Cpu::daa(){
 
 // helper function called to emulate any 8080 binary opcode
 int Cpu::emulateInstruction(){
-    return getInstruction(memory[registers.pc]);
+    return runOpcode(memory[registers.pc], operandsAfter(registers.pc));
+}
+
+
+/**************************************************************************************************
+    ** Function Name: int Cpu::emulateBlock()
+    ** Description: Runs the basic block starting at the pc, decoding and caching it first if it
+        has not been seen before. The cycles of the straight-line body were summed when the block
+        was built, so only the closing branch's cycles come from its handler. If an instruction
+        writes over cached code the block stops early and the rest is decoded again on the next
+        call. Immediate operands come from the decoded ops rather than from memory.
+**************************************************************************************************/
+int Cpu::emulateBlock(){
+    BlockCache::Block *block = blockCache.lookup(registers.pc);
+    if(block == nullptr){
+        block = blockCache.build(memory, registers.pc);
+    }
+    return runBlock(block);
+}
+
+//interprets every instruction of a block that starts at the pc, see emulateBlock
+int Cpu::runBlock(BlockCache::Block *block){
+    uint32_t generation = blockCache.generation;
+    int last = block->opCount - 1;
+    for(int i = 0; i < last; ++i){
+        int cyclesSoFar = block->ops[i].cycleSum;
+        runOpcode(block->ops[i].opcode, &block->ops[i].low);
+        if(blockCache.generation != generation){
+            return cyclesSoFar;
+        }
+    }
+    int bodyCycles = block->bodyCycles;
+    return bodyCycles + runOpcode(block->ops[last].opcode, &block->ops[last].low);
 }
 
 // Generates a video interrupt (either RST 0 or RST 1 opcodes)
@@ -895,23 +943,31 @@ bool Cpu::generateInterrupt(uint8_t opCode){
     bool success = false;
     if(enableInterrupts){
         enableInterrupts = false;
-        getInstruction(opCode);
+#ifdef CPU_PROFILING
+        //counted apart from the instructions, the rst was not fetched from the interrupted pc
+        int cycles = chargeCycles(opCode, dispatchOpcode(opCode));
+        profiler.recordInterrupt(opCode, cycles);
+#else
+        runOpcode(opCode, nullptr);         //an rst has no operands
+#endif
         success = true;
     }
     return success;
 }
 
-// Reads binary opcode and calls corresponding function to handle opcode
+// Reads binary opcode and calls corresponding function to handle opcode, kept as the reference
+// the specialised handlers are checked against
 int Cpu::getInstruction(uint8_t operation){
+    operands = operandsAfter(registers.pc);
     switch(operation){
         case 0x00:
             return nop();
         case 0x01:
-            return lxi(registers.b, registers.c);
+            return lxi(registers.bc);
         case 0x02:
-            return stax(registers.b, registers.c);
+            return stax(registers.bc);
         case 0x03:
-            return inx(registers.b, registers.c);
+            return inx(registers.bc);
         case 0x04:
             return inr(registers.b);
         case 0x05:
@@ -923,11 +979,11 @@ int Cpu::getInstruction(uint8_t operation){
         case 0x08:
             return nop();
         case 0x09:
-            return dad(registers.b, registers.c);
+            return dad(registers.bc);
         case 0x0A:
-            return ldax(registers.b, registers.c);
+            return ldax(registers.bc);
         case 0x0B:
-            return dcx(registers.b, registers.c);
+            return dcx(registers.bc);
         case 0x0C:
             return inr(registers.c);
         case 0x0D:
@@ -939,11 +995,11 @@ int Cpu::getInstruction(uint8_t operation){
         case 0x10:
             return nop();
         case 0x11:
-            return lxi(registers.d, registers.e);
+            return lxi(registers.de);
         case 0x12:
-            return stax(registers.d, registers.e);
+            return stax(registers.de);
         case 0x13:
-            return inx(registers.d, registers.e);
+            return inx(registers.de);
         case 0x14:
             return inr(registers.d);
         case 0x15:
@@ -955,27 +1011,27 @@ int Cpu::getInstruction(uint8_t operation){
         case 0x18:
             return nop();
         case 0x19:
-            return dad(registers.d, registers.e);
+            return dad(registers.de);
         case 0x1A:
-            return ldax(registers.d, registers.e);
+            return ldax(registers.de);
         case 0x1B:
-            return dcx(registers.d, registers.e);
+            return dcx(registers.de);
         case 0x1C:
             return inr(registers.e);
         case 0x1D:
             return dcr(registers.e);
         case 0x1E:
-            return mvi(registers.c);
+            return mvi(registers.e);
         case 0x1F:
             return rar();
         case 0x20:
             return nop();
         case 0x21:
-            return lxi(registers.h, registers.l);
+            return lxi(registers.hl);
         case 0x22:
             return shld();
         case 0x23:
-            return inx(registers.h, registers.l);
+            return inx(registers.hl);
         case 0x24:
             return inr(registers.h);
         case 0x25:
@@ -987,11 +1043,11 @@ int Cpu::getInstruction(uint8_t operation){
         case 0x28:
             return nop();
         case 0x29:
-            return dad(registers.h, registers.l);
+            return dad(registers.hl);
         case 0x2A:
             return lhld();
         case 0x2B:
-            return dcx(registers.h, registers.l);
+            return dcx(registers.hl);
         case 0x2C:
             return inr(registers.l);
         case 0x2D:
@@ -1003,11 +1059,11 @@ int Cpu::getInstruction(uint8_t operation){
         case 0x30:
             return nop();
         case 0x31:
-            return lxiSP();
+            return lxi(registers.sp);
         case 0x32:
             return sta();
         case 0x33:
-            return inxSP();
+            return inx(registers.sp);
         case 0x34:
             return inrM();
         case 0x35:
@@ -1019,11 +1075,11 @@ int Cpu::getInstruction(uint8_t operation){
         case 0x38:
             return nop();
         case 0x39:
-            return dadSP();
+            return dad(registers.sp);
         case 0x3A:
             return lda();
         case 0x3B:
-            return dcxSP();
+            return dcx(registers.sp);
         case 0x3C:
             return inr(registers.a);
         case 0x3D:
@@ -1291,7 +1347,7 @@ int Cpu::getInstruction(uint8_t operation){
         case 0xC0:
             return conditionalRet(!flags.testBits(ZERO_BIT));
         case 0xC1:
-            return pop(registers.b, registers.c);
+            return pop(registers.bc);
         case 0xC2:
             return conditionalJmp(!flags.testBits(ZERO_BIT));
         case 0xC3:
@@ -1299,7 +1355,7 @@ int Cpu::getInstruction(uint8_t operation){
         case 0xC4:
             return conditionalCall(!flags.testBits(ZERO_BIT));
         case 0xC5:
-            return push(registers.b, registers.c);
+            return push(registers.bc);
         case 0xC6:
             return adi();
         case 0xC7:
@@ -1323,7 +1379,7 @@ int Cpu::getInstruction(uint8_t operation){
         case 0xD0:
             return conditionalRet(!flags.testBits(CARRY_BIT));
         case 0xD1:
-            return pop(registers.d, registers.e);
+            return pop(registers.de);
         case 0xD2:
             return conditionalJmp(!flags.testBits(CARRY_BIT));
         case 0xD3:
@@ -1331,7 +1387,7 @@ int Cpu::getInstruction(uint8_t operation){
         case 0xD4:
             return conditionalCall(!flags.testBits(CARRY_BIT));
         case 0xD5:
-            return push(registers.d, registers.e);
+            return push(registers.de);
         case 0xD6:
             return sui();
         case 0xD7:
@@ -1355,7 +1411,7 @@ int Cpu::getInstruction(uint8_t operation){
         case 0xE0:
             return conditionalRet(!flags.testBits(PARITY_BIT));
         case 0xE1:
-            return pop(registers.h, registers.l);
+            return pop(registers.hl);
         case 0xE2:
             return conditionalJmp(!flags.testBits(PARITY_BIT));
         case 0xE3:
@@ -1363,7 +1419,7 @@ int Cpu::getInstruction(uint8_t operation){
         case 0xE4:
             return conditionalCall(!flags.testBits(PARITY_BIT));
         case 0xE5:
-            return push(registers.h, registers.l);
+            return push(registers.hl);
         case 0xE6:
             return ani();
         case 0xE7:
@@ -1421,3 +1477,328 @@ int Cpu::getInstruction(uint8_t operation){
 }
 
 
+
+
+//bit fields every opcode is decoded from, bits 3-5 hold the destination register, condition or
+//RST vector, bits 0-2 hold the source register and bits 4-5 hold the register pair
+constexpr int destinationField(uint8_t opcode){ return (opcode >> 3) & 7; }
+constexpr int sourceField(uint8_t opcode){ return opcode & 7; }
+constexpr int pairField(uint8_t opcode){ return (opcode >> 4) & 3; }
+const int M_FIELD = 6;                  //register field value selecting the "M Register"
+const int SP_PSW_FIELD = 3;             //pair field value selecting sp, or PSW for push and pop
+
+
+//returns the register selected by a register field, M is handled by the callers
+template<int field>
+uint8_t& Cpu::registerField(){
+    switch(field){
+    case 0: return registers.b;
+    case 1: return registers.c;
+    case 2: return registers.d;
+    case 3: return registers.e;
+    case 4: return registers.h;
+    case 5: return registers.l;
+    default: return registers.a;
+    }
+}
+
+//returns the register pair selected by a pair field, field 3 being sp
+template<int field>
+uint16_t& Cpu::registerPairField(){
+    switch(field){
+    case 0: return registers.bc;
+    case 1: return registers.de;
+    case 2: return registers.hl;
+    default: return registers.sp;
+    }
+}
+
+//tests the condition selected by a condition field: NZ, Z, NC, C, PO, PE, P, M
+template<int field>
+bool Cpu::conditionField(){
+    switch(field){
+    case 0: return !flags.testBits(ZERO_BIT);
+    case 1: return flags.testBits(ZERO_BIT);
+    case 2: return !flags.testBits(CARRY_BIT);
+    case 3: return flags.testBits(CARRY_BIT);
+    case 4: return !flags.testBits(PARITY_BIT);
+    case 5: return flags.testBits(PARITY_BIT);
+    case 6: return !flags.testBits(SIGN_BIT);
+    default: return flags.testBits(SIGN_BIT);
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: template<uint8_t opcode> int Cpu::specialisedHandler()
+    ** Description: Runs opcode with its registers, condition and RST vector worked out from the
+        opcode's bit fields at compile time. Every branch below tests a constant, so each of the
+        256 instances compiles down to the one handler it selects with its operands fixed and no
+        register, pair or condition is picked at run time.
+**************************************************************************************************/
+template<uint8_t opcode>
+int Cpu::specialisedHandler(){
+    const int destination = destinationField(opcode);
+    const int source = sourceField(opcode);
+    const int pair = pairField(opcode);
+
+    //0x40 - 0xBF, register moves then arithmetic and logic on the a register
+    if(opcode == 0x76){
+        return hlt();
+    }
+    if((opcode & 0xC0) == 0x40){
+        if(source == M_FIELD){
+            return movMTo(registerField<destination>());
+        }
+        if(destination == M_FIELD){
+            return movToM(registerField<source>());
+        }
+        return mov(registerField<destination>(), registerField<source>());
+    }
+    if((opcode & 0xC0) == 0x80){
+        if(source == M_FIELD){
+            switch(destination){
+            case 0: return addM();
+            case 1: return adcM();
+            case 2: return subM();
+            case 3: return sbbM();
+            case 4: return anaM();
+            case 5: return xraM();
+            case 6: return oraM();
+            default: return cmpM();
+            }
+        }
+        switch(destination){
+        case 0: return add(registerField<source>());
+        case 1: return adc(registerField<source>());
+        case 2: return sub(registerField<source>());
+        case 3: return sbb(registerField<source>());
+        case 4: return ana(registerField<source>());
+        case 5: return xra(registerField<source>());
+        case 6: return ora(registerField<source>());
+        default: return cmp(registerField<source>());
+        }
+    }
+
+    //0x00 - 0x3F, loads, increments and the a register rotates
+    if((opcode & 0xC0) == 0x00){
+        switch(source){
+        case 0:
+            return nop();
+        case 1:
+            if(opcode & 0x08){
+                return dad(registerPairField<pair>());
+            }
+            return lxi(registerPairField<pair>());
+        case 2:
+            switch(destination){
+            case 0: return stax(registers.bc);
+            case 1: return ldax(registers.bc);
+            case 2: return stax(registers.de);
+            case 3: return ldax(registers.de);
+            case 4: return shld();
+            case 5: return lhld();
+            case 6: return sta();
+            default: return lda();
+            }
+        case 3:
+            if(opcode & 0x08){
+                return dcx(registerPairField<pair>());
+            }
+            return inx(registerPairField<pair>());
+        case 4:
+            return destination == M_FIELD ? inrM() : inr(registerField<destination>());
+        case 5:
+            return destination == M_FIELD ? dcrM() : dcr(registerField<destination>());
+        case 6:
+            return destination == M_FIELD ? mviM() : mvi(registerField<destination>());
+        default:
+            switch(destination){
+            case 0: return rlc();
+            case 1: return rrc();
+            case 2: return ral();
+            case 3: return rar();
+            case 4: return daa();
+            case 5: return cma();
+            case 6: return stc();
+            default: return cmc();
+            }
+        }
+    }
+
+    //0xC0 - 0xFF, branches, the stack, I/O and immediate arithmetic
+    switch(source){
+    case 0:
+        return conditionalRet(conditionField<destination>());
+    case 1:
+        switch(destination){
+        case 1:
+        case 3: return ret();
+        case 5: return pchl();
+        case 7: return sphl();
+        default: return pair == SP_PSW_FIELD ? popPSW() : pop(registerPairField<pair>());
+        }
+    case 2:
+        return conditionalJmp(conditionField<destination>());
+    case 3:
+        switch(destination){
+        case 0:
+        case 1: return jmp();
+        case 2: return out();
+        case 3: return in();
+        case 4: return xthl();
+        case 5: return xchg();
+        case 6: return di();
+        default: return ei();
+        }
+    case 4:
+        return conditionalCall(conditionField<destination>());
+    case 5:
+        if(opcode & 0x08){
+            return call();
+        }
+        return pair == SP_PSW_FIELD ? pushPSW() : push(registerPairField<pair>());
+    case 6:
+        switch(destination){
+        case 0: return adi();
+        case 1: return aci();
+        case 2: return sui();
+        case 3: return sbi();
+        case 4: return ani();
+        case 5: return xri();
+        case 6: return ori();
+        default: return cpi();
+        }
+    default:
+        return rst(destination);
+    }
+}
+
+//one case per opcode calling its specialised handler, the switch becomes a jump table and
+//each handler is small enough to be inlined into its case
+#define HANDLER(opcode) case (opcode): return specialisedHandler<(opcode)>();
+#define HANDLERS_4(base) HANDLER(base) HANDLER(base + 1) HANDLER(base + 2) HANDLER(base + 3)
+#define HANDLERS_16(base) HANDLERS_4(base) HANDLERS_4(base + 4) HANDLERS_4(base + 8) HANDLERS_4(base + 12)
+#define HANDLERS_64(base) HANDLERS_16(base) HANDLERS_16(base + 16) HANDLERS_16(base + 32) HANDLERS_16(base + 48)
+
+// Runs an opcode through its specialised handler
+int Cpu::dispatchOpcode(uint8_t opcode){
+    switch(opcode){
+        HANDLERS_64(0x00)
+        HANDLERS_64(0x40)
+        HANDLERS_64(0x80)
+        HANDLERS_64(0xC0)
+    }
+    return 0;
+}
+
+#undef HANDLERS_64
+#undef HANDLERS_16
+#undef HANDLERS_4
+#undef HANDLER
+
+
+/**************************************************************************************************
+    ** Function Name: bool Cpu::verifyHandlers()
+    ** Description: Checks that every specialised handler does the same thing as the opcode's case
+        in getInstruction. Each opcode is run through both from the same randomised registers,
+        flags and memory, and the resulting state and cycle counts are compared. Mismatches are
+        reported with qWarning. hlt is skipped as it ends the program, and out is only given
+        ports that do not play sounds. The Cpu's state is put back afterwards.
+**************************************************************************************************/
+bool Cpu::verifyHandlers(){
+    const int TRIALS = 16;
+
+    //keep the real state so it can be put back at the end
+    State8080Registers savedRegisters = registers;
+    Flags savedFlags = flags;
+    bool savedInterrupts = enableInterrupts;
+    ShiftRegister savedShifter = shifter;
+    uint8_t savedIO[] = {output3, output5, output6};
+    uint8_t *savedMemory = new uint8_t[0x10000];
+    memcpy(savedMemory, memory, 0x10000);
+
+    uint8_t *startMemory = new uint8_t[0x10000];
+    uint8_t *expectedMemory = new uint8_t[0x10000];
+    uint32_t seed = 0x8080;
+    int mismatches = 0;
+
+    for(int opcode = 0; opcode < 256; ++opcode){
+        if(opcode == 0x76){
+            continue;
+        }
+        for(int trial = 0; trial < TRIALS; ++trial){
+            //random starting state, with the opcode placed at the pc
+            for(int i = 0; i < 0x10000; ++i){
+                seed = seed * 1103515245 + 12345;
+                startMemory[i] = seed >> 16;
+            }
+            seed = seed * 1103515245 + 12345;
+            State8080Registers startRegisters;
+            memset(&startRegisters, 0, sizeof(State8080Registers));
+            startRegisters.bc = startMemory[trial] | (startMemory[trial + 16] << 8);
+            startRegisters.de = startMemory[trial + 32] | (startMemory[trial + 48] << 8);
+            startRegisters.hl = startMemory[trial + 64] | (startMemory[trial + 80] << 8);
+            startRegisters.a = startMemory[trial + 96];
+            startRegisters.sp = startMemory[trial + 112] | (startMemory[trial + 128] << 8);
+            startRegisters.pc = seed >> 16;
+            uint8_t startFlags = (startMemory[trial + 144] & 0xD5) | EMPTY_FLAG;
+            startMemory[startRegisters.pc] = opcode;
+            if(opcode == 0xD3){
+                startMemory[(uint16_t)(startRegisters.pc + 1)] = (trial & 1) ? 2 : 4;
+            }
+
+            //the shift register keeps what was written before, so both runs start it the same
+            ShiftRegister startShifter = shifter;
+
+            //the reference run through getInstruction
+            registers = startRegisters;
+            flags = Flags(startFlags);
+            memcpy(memory, startMemory, 0x10000);
+            int expectedCycles = getInstruction(opcode);
+            State8080Registers expected = registers;
+            uint8_t expectedFlags = flags.getRegisterValue();
+            uint16_t expectedShift = shifter.contents;
+            uint8_t expectedIO[] = {shifter.amount, output3, output5, output6, enableInterrupts};
+            memcpy(expectedMemory, memory, 0x10000);
+
+            //the same state through the specialised handler
+            registers = startRegisters;
+            flags = Flags(startFlags);
+            memcpy(memory, startMemory, 0x10000);
+            shifter = startShifter;
+            int cycles = executeOpcode(opcode);
+            uint8_t io[] = {shifter.amount, output3, output5, output6, enableInterrupts};
+
+            bool registersMatch = registers.bc == expected.bc && registers.de == expected.de
+                    && registers.hl == expected.hl && registers.a == expected.a
+                    && registers.pc == expected.pc && registers.sp == expected.sp;
+            if(cycles != expectedCycles || flags.getRegisterValue() != expectedFlags || !registersMatch
+                    || shifter.contents != expectedShift || memcmp(io, expectedIO, sizeof(io)) != 0
+                    || memcmp(memory, expectedMemory, 0x10000) != 0){
+                qWarning("Specialised handler for opcode 0x%02X does not match getInstruction", opcode);
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    //put the real state back
+    registers = savedRegisters;
+    flags = savedFlags;
+    enableInterrupts = savedInterrupts;
+    shifter = savedShifter;
+    output3 = savedIO[0];
+    output5 = savedIO[1];
+    output6 = savedIO[2];
+    memcpy(memory, savedMemory, 0x10000);
+    blockCache.clear();
+#ifdef CPU_PROFILING
+    profiler.reset();               //the calls and returns run here are not the program's
+#endif
+
+    delete[] savedMemory;
+    delete[] startMemory;
+    delete[] expectedMemory;
+    return mismatches == 0;
+}
@@ -8,27 +8,47 @@
 #include <QObject>
 
 #include "../flags/flags.h"
+#include "../io/ioBus.h"
+#include "../io/shiftRegister.h"
+#include "../machine/machine.h"
+#include "blockCache.h"
+#ifdef CPU_PROFILING
+#include "../profiler/profiler.h"
+#endif
 
 #ifndef CPU_H
 #define CPU_H
 
+//lays out the two halves of a register pair so they overlay its 16 bit value in a union
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+#define REGISTER_PAIR(high, low) uint8_t low; uint8_t high;
+#else
+#define REGISTER_PAIR(high, low) uint8_t high; uint8_t low;
+#endif
 
 
-class Cpu : public QObject
+class Cpu : public QObject, public IoDevice
 {
     Q_OBJECT
 public:
     Cpu();                              //default constructor
     ~Cpu();                             //destructor
-    //registers
+    //registers, the BC, DE and HL pairs can be used as one 16 bit value or as two 8 bit
+    //registers. The PSW pair is built when needed as the flags are kept in a Flags object
     struct State8080Registers{
+        union{
+            struct{ REGISTER_PAIR(b, c) };
+            uint16_t bc;
+        };
+        union{
+            struct{ REGISTER_PAIR(d, e) };
+            uint16_t de;
+        };
+        union{
+            struct{ REGISTER_PAIR(h, l) };
+            uint16_t hl;
+        };
         uint8_t a;
-        uint8_t b;
-        uint8_t c;
-        uint8_t d;
-        uint8_t e;
-        uint8_t h;
-        uint8_t l;
         uint16_t pc;
         uint16_t sp;
     } registers;
@@ -38,20 +58,48 @@ public:
     bool enableInterrupts;              //flag for enabling interrupts
     bool twoPlayer;                     //internal flag for 1 or 2 player game
 
-    //inputs and outputs
+    //inputs and outputs, the latches keep the names of the Space Invaders ports they started
+    //as, output3 and output5 being the sound latches wherever a board puts them
     uint8_t input0;
     uint8_t input1;
     uint8_t input2;
-    uint8_t input3;
 
-    uint8_t output2;
     uint8_t output3;
-    uint8_t output4;
     uint8_t output5;
     uint8_t output6;
 
+    //the board's ports, wired up from its PortMap by setPorts. The latches above are the Cpu's
+    //own registers as an IoDevice, and the shift register is a device of its own
+    enum Latch{
+        INPUT0,
+        INPUT1,
+        INPUT2,
+        SOUND1,
+        SOUND2,
+        WATCHDOG
+    };
+    IoBus io;
+    ShiftRegister shifter;
+    void setPorts(const PortMap &ports);
+    uint8_t read(int reg);                      //reads an input latch for the io bus
+    void write(int reg, uint8_t value);         //writes a sound latch or the watchdog for the io bus
+
     //memory
     uint8_t *memory;
+    void writeMemory(uint16_t address, uint8_t value);
+
+    //pre-decoded basic blocks, used by emulateBlock
+    BlockCache blockCache;
+    bool blockCacheEnabled;
+
+    //a HLT ends the program unless exitOnHalt is cleared, in which case it sets halted and the
+    //caller decides what to do, as the CpmRunner does
+    bool exitOnHalt;
+    bool halted;
+
+#ifdef CPU_PROFILING
+    Profiler profiler;                  //opcode, address and call counts of everything run
+#endif
 
     //generateInterrupts function
     bool generateInterrupt(uint8_t opCode);
@@ -63,8 +111,72 @@ public:
 
     //emulating functions
     int emulateInstruction();
+    int emulateBlock();
+    int runBlock(BlockCache::Block *block);
     int getInstruction(uint8_t);
 
+    //the immediate bytes of the instruction being run, in memory after the opcode when single
+    //stepping and in the block cache's decoded copy when a block is replayed, so the handlers
+    //never fetch them from memory again
+    const uint8_t *operands;
+    uint8_t operand8(){
+        return operands[0];
+    }
+    uint16_t operand16(){
+        return (operands[1] << 8) | operands[0];
+    }
+
+    //returns the bytes after the opcode at pc, copied to wrappedOperands when they wrap past the
+    //top of memory so the handlers never read beyond the 64K buffer
+    const uint8_t* operandsAfter(uint16_t pc){
+        if(pc < 0xFFFE){
+            return &memory[pc + 1];
+        }
+        wrappedOperands[0] = memory[(uint16_t)(pc + 1)];
+        wrappedOperands[1] = memory[(uint16_t)(pc + 2)];
+        return wrappedOperands;
+    }
+    uint8_t wrappedOperands[2];
+
+    //handlers with their operands fixed at compile time, see specialisedHandler
+    int executeOpcode(uint8_t opcode){
+        operands = operandsAfter(registers.pc);
+        return dispatchOpcode(opcode);
+    }
+    int dispatchOpcode(uint8_t opcode);         //runs opcode on the bytes operands points at
+
+    //runs an opcode whose immediate bytes are at opcodeOperands, through the profiler when it
+    //is built in
+    int runOpcode(uint8_t opcode, const uint8_t *opcodeOperands){
+        operands = opcodeOperands;
+#ifdef CPU_PROFILING
+        //counted up front at the table cost, which is the not taken cost of a conditional call or
+        //return, so nothing has to be kept across the handler. The handlers for calls, rsts and
+        //returns move the call tree and add the cost of taking a branch
+        profiler.record(registers.pc, cycleTable[opcode]);
+#endif
+        return chargeCycles(opcode, dispatchOpcode(opcode));
+    }
+
+    //instruction timing, see cycles.h
+    bool strictTiming;                          //charge data sheet cycles for every opcode
+    uint8_t cycleTable[256];                    //cycles charged per opcode in the current mode
+    void setStrictTiming(bool strict);
+
+    //returns the cycles to charge for an opcode whose handler returned handlerCycles, only
+    //conditional calls and returns keep the handler's count as it depends on the branch
+    int chargeCycles(uint8_t opcode, int handlerCycles){
+        if(!strictTiming || isConditionalCallOrReturn(opcode)){
+            return handlerCycles;
+        }
+        return CYCLES_8080[opcode];
+    }
+    template<uint8_t opcode> int specialisedHandler();
+    template<int field> uint8_t& registerField();
+    template<int field> uint16_t& registerPairField();
+    template<int field> bool conditionField();
+    bool verifyHandlers();                      //checks executeOpcode against getInstruction
+
     //opcode functions
     //logic op functions
     int ana(uint8_t secondRegister);
@@ -91,10 +203,9 @@ public:
     int movMTo(uint8_t &destination);
     int mvi(uint8_t &destination);
     int mviM();
-    int lxi(uint8_t &nameRegister, uint8_t &nextRegister);
-    int lxiSP();
-    int ldax(uint8_t nameRegister, uint8_t nextRegister);
-    int stax(uint8_t nameRegister, uint8_t nextRegister);
+    int lxi(uint16_t &registerPair);
+    int ldax(uint16_t address);
+    int stax(uint16_t address);
     int shld();
     int lhld();
     int sta();
@@ -114,24 +225,21 @@ public:
     int rst(uint8_t resetNumber);
     int ret();
     int conditionalRet(bool condition);
-    int push(uint8_t nameRegister, uint8_t nextRegister);
+    int push(uint16_t registerPair);
     int pushPSW();
-    int pop(uint8_t &nameRegister, uint8_t &nextRegister);
+    int pop(uint16_t &registerPair);
     int popPSW();
     int sphl();
     int xthl();
 
     //arithmetic functions
-    int inx(uint8_t &nameRegister, uint8_t &nextRegister);
-    int inxSP();
-    int dcx(uint8_t &nameRegister, uint8_t &nextRegister);
-    int dcxSP();
+    int inx(uint16_t &registerPair);
+    int dcx(uint16_t &registerPair);
     int inr(uint8_t &regName);
     int inrM();
     int dcr(uint8_t &regName);
     int dcrM();
-    int dad(uint8_t nameRegister, uint8_t nextRegister);
-    int dadSP();
+    int dad(uint16_t registerPair);
     int add(uint8_t regName);
     int addM();
     int adc(uint8_t regName);
@@ -149,8 +257,8 @@ public:
     int daa();
 
 signals:
-    void writeOnPort3(int raw);                 //used for triggering sounds on port 3
-    void writeOnPort5(int raw);                 //used for triggering sounds on port 5
+    void writeOnPort3(int raw);                 //sent when a write changes the sounds on port 3
+    void writeOnPort5(int raw);                 //sent when a write changes the sounds on port 5
 };
 
 #endif // CPU_H
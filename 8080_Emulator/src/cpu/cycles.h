@@ -0,0 +1,54 @@
+/**************************************************************************************************
+    ** File Name: cycles.h
+    ** Description: This file holds the cycle counts of every 8080 opcode. CYCLES_8080 is the
+        authoritative table, taken from the Intel 8080 data sheet, with the M operand forms at
+        their full cost and conditional calls and returns at their cost when not taken. The
+        emulator has always charged a few opcodes differently; those are listed separately in
+        LEGACY_CYCLE_DIFFERENCES so the default timing, and the replays and traces recorded with
+        it, stay in step. Strict timing uses the data sheet for everything.
+**************************************************************************************************/
+#include <stdint.h>
+
+#ifndef CYCLES_H
+#define CYCLES_H
+
+const int TAKEN_BRANCH_CYCLES = 6;              //extra cost of a conditional call or return taken
+
+//cycles for each opcode from the data sheet
+const uint8_t CYCLES_8080[256] = {
+     4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,     //0x00
+     4, 10,  7,  5,  5,  5,  7,  4,  4, 10,  7,  5,  5,  5,  7,  4,     //0x10
+     4, 10, 16,  5,  5,  5,  7,  4,  4, 10, 16,  5,  5,  5,  7,  4,     //0x20
+     4, 10, 13,  5, 10, 10, 10,  4,  4, 10, 13,  5,  5,  5,  7,  4,     //0x30
+     5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,     //0x40
+     5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,     //0x50
+     5,  5,  5,  5,  5,  5,  7,  5,  5,  5,  5,  5,  5,  5,  7,  5,     //0x60
+     7,  7,  7,  7,  7,  7,  7,  7,  5,  5,  5,  5,  5,  5,  7,  5,     //0x70
+     4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,     //0x80
+     4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,     //0x90
+     4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,     //0xA0
+     4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,     //0xB0
+     5, 10, 10, 10, 11, 11,  7, 11,  5, 10, 10, 10, 11, 17,  7, 11,     //0xC0
+     5, 10, 10, 10, 11, 11,  7, 11,  5, 10, 10, 10, 11, 17,  7, 11,     //0xD0
+     5, 10, 10, 18, 11, 11,  7, 11,  5,  5, 10,  4, 11, 17,  7, 11,     //0xE0
+     5, 10, 10,  4, 11, 11,  7, 11,  5,  5, 10,  4, 11, 17,  7, 11      //0xF0
+};
+
+//opcodes the default timing charges differently from the data sheet, and what it charges
+struct CycleDifference{
+    uint8_t opcode;
+    uint8_t cycles;
+};
+const CycleDifference LEGACY_CYCLE_DIFFERENCES[] = {
+    {0x34, 5},                                  //inr m, charged as inr r
+    {0x35, 5},                                  //dcr m, charged as dcr r
+    {0x76, 4},                                  //hlt
+    {0xEB, 5},                                  //xchg
+};
+
+//checks if an opcode is a conditional call or return, the only ones whose cost depends on a branch
+inline bool isConditionalCallOrReturn(uint8_t opcode){
+    return (opcode & 0xC3) == 0xC0;
+}
+
+#endif // CYCLES_H
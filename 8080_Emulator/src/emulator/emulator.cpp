@@ -2,238 +2,761 @@
     ** File Name: emulator.cpp
     ** Description: This file contains the member function definitions for the Emulator class.
 **************************************************************************************************/
+#include <QDataStream>
 #include <QFile>
 #include <QTextStream>
 #include <QBitMap>                          //for setting pixmap for screen painting
 #include <QDebug>
 #include <QTime>
-#include <QSound>
 #include "emulator.h"
+#include "../concurrency/hostClock.h"
+#include "../metrics/metrics.h"
+#include "../options/options.h"
+#include "../rom/romLoader.h"
 
 
-QSoundEffect effect;                    //used for discrete music effects
-
-
-// half frame time set to 1/120 of a second in nanoseconds
-// 2 interrupts are sent per frame (60fps), helps us match the 8080 cpu clock speed
-#define HALF_FRAME 8333333
-// the maximum number of cycles per half frame, based on the 8080 cpu clock speed
-// of 2 Mhz
-#define MAX_CYCLES 16667;
+// the video hardware scans 262 lines a frame, 224 of them visible, and the cpu runs 128 cycles
+// per line at its clock of 19.968 MHz / 10, so a frame is 33536 cycles long and lasts 1/59.54 s
+#define SCANLINES 262
+#define CYCLES_PER_SCANLINE 128
+#define CPU_CLOCK 1996800
+// line the beam has reached when the end of screen interrupt fires, the last one shown. Where the
+// mid screen one fires is up to the board, see Machine
+#define END_OF_SCREEN_LINE 224
+// with --audio-sync, the most a half frame is stretched or shrunk by to keep the emulation where
+// the sound source expects it, and the number of half frames the lead over the audio is averaged
+// over so the jitter of the audio thread's buffer fills does not reach the pacing
+#define AUDIO_SYNC_MAX_ADJUST 0.005
+#define AUDIO_SYNC_SMOOTHING 16
+// frames between profile saves, so a running cabinet always has a recent profile on disk and the
+// profiler's 32 bit counters are folded long before they could wrap
+#define PROFILE_INTERVAL 3600
+// identifies a snapshot and the version of its layout
+#define SNAPSHOT_MAGIC "8080SNP2"
 
 
 //constructor that dynamically allocates memory and sets up the screen for emulator
-Emulator::Emulator()
+Emulator::Emulator() : jit(&cpu),
+    sound(Options::instance().synthSound ? (SoundSource*)&synth : &mixer), audio(sound)
 {
-    effect.setVolume(0.25f);
+    machine = Machine::find(Options::instance().machine);
+    midScreenLine = machine->midScreenLine;
+    cyclesUntilInterrupt = midScreenLine * CYCLES_PER_SCANLINE;   //the beam starts at the top
+    vBlank = true;
+    renderHalves = Options::instance().renderHalves;
+    renderLines = Options::instance().renderLines;
+    audioSync = Options::instance().audioSync;
+    audioLead = AUDIO_WRITE_DELAY;
+    paintedLine = 0;
+    paintDue = 0;
+    frameCycles = 0;
+    memset(&frameTiming, 0, sizeof(FrameTiming));
+    memset(&inputTiming, 0, sizeof(InputTiming));
+    shownFrames = 0;
+    frameEnded = false;
+    lastShown = 0;
+    showFrame = true;
+    turboAlways = Options::instance().turbo;
+    turbo = turboAlways;
+    frameStarted = 0;
+    renderNanoseconds = 0;
+    waitNanoseconds = 0;
+    waitStarted = 0;
+#ifdef CPU_PROFILING
+    framesUntilProfile = PROFILE_INTERVAL;
+#endif
+
+    //checked before the sound slots are connected so the out instructions it runs stay silent
+    if(Options::instance().verifyHandlers && !cpu.verifyHandlers()){
+        qFatal("Specialised opcode handlers do not match the reference decoder");
+    }
+
+    if(Options::instance().strictTiming){
+        cpu.setStrictTiming(true);
+    }
+    cpu.blockCacheEnabled = Options::instance().blockCache;
+
+    //the Jit is only started when asked for, and falls back to the interpreter on failure
+    if(Options::instance().jit){
+        jit.verify = Options::instance().jitVerify;
+        jit.start();
+    }
+
+    //a trace needs every instruction on its own, so recording one single steps the Cpu
+    QString tracePath = Options::instance().tracePath;
+    if(!tracePath.isEmpty() && !trace.open(tracePath)){
+        qWarning("Failed to create the trace file %s", qPrintable(tracePath));
+    }
+
+    //the board's ports, and the colours it has until loadRom brings in any colour prom
+    cpu.setPorts(machine->ports);
+    cpu.input0 = machine->inputDefaults[0];
+    cpu.input1 = machine->inputDefaults[1];
+    cpu.input2 = machine->inputDefaults[2];
+    memset(colourProm, 0, COLOUR_PROM_SIZE);
+    buildColours();
+
     originalScreen = QImage(256, 224, QImage::Format_RGB32);
     transform.rotate(-90);
     transform.scale(2, 2);
 
-    connect(&cpu, SIGNAL(writeOnPort3(int)), this, SLOT(playSoundPort3(int)));
-    connect(&cpu, SIGNAL(writeOnPort5(int)), this, SLOT(playSoundPort5(int)));
+    //the sound slots run on the emulation thread and only queue the writes for the audio thread
+    connect(&cpu, SIGNAL(writeOnPort3(int)), this, SLOT(playSoundPort3(int)), Qt::DirectConnection);
+    connect(&cpu, SIGNAL(writeOnPort5(int)), this, SLOT(playSoundPort5(int)), Qt::DirectConnection);
 }
 
-// draws the screen by reading bitmap in video ram at address 0x2400
+// draws the whole screen from video ram and shows it
 void Emulator::paintScreen(){
-    for(int i = 0; i < 224; ++i){
+    paintLines(0, END_OF_SCREEN_LINE);
+    showScreen();
+}
+
+// draws lines first up to last of the screen by reading bitmap in video ram at address 0x2400
+void Emulator::paintLines(int first, int last){
+    int64_t start = hostNanoseconds();
+    for(int i = first; i < last; ++i){
         for(int j = 0; j < 32; ++j){
             uint8_t currentByte = cpu.memory[0x2400 + i * 32 + j];
             for(int k = 0; k < 8; ++k){
                 int xPosition = j * 8 + k;
                 int yPosition = i;
 
-                QColor color;
+                QRgb color = qRgb(0, 0, 0);
                 int currentPixel = currentByte >> k & 1;
                 if(currentPixel){
-                    color = paintPixel(xPosition);
+                    color = screenColours[yPosition >> 3][xPosition];
                 }
-                else{
-                    color = Qt::black;
-                }
-                originalScreen.setPixel(xPosition, yPosition, color.rgb());
+                originalScreen.setPixel(xPosition, yPosition, color);
             }
         }
     }
+    renderNanoseconds += hostNanoseconds() - start;
+}
+
+// sends the lines painted so far to the gui
+void Emulator::showScreen(){
+    int64_t start = hostNanoseconds();
     // the video ram bitmap is rotated clockwise, so we need to rotate counterclockwise correct it
     rotatedScreen = originalScreen.transformed(transform);
-    emit screenIsUpdated(&rotatedScreen);
+    emit screenIsUpdated(&rotatedScreen, ++shownFrames);
+    lastShown = hostNanoseconds();
+    renderNanoseconds += lastShown - start;
 }
 
-//Paints activated pixels on the screen their proper color according to screen dimensions
-QColor Emulator::paintPixel(int pixelPosition){
-    if(pixelPosition >= 224){
-        return Qt::white;
+
+
+/**************************************************************************************************
+    ** Function Name: void Emulator::buildColours()
+    ** Description: Works out the colour a lit pixel has at every place on the screen, so
+        paintLines only has to look it up. Boards with a colour prom give each block of 8 lines
+        by 8 pixels one of 8 colours, read from the prom at the block's video RAM address
+        counted from the start of RAM, the bits being red, blue and green. The others take the
+        colour of the overlay band the pixel is under, or white where there is no overlay.
+**************************************************************************************************/
+void Emulator::buildColours(){
+    bool prom = machine->hasColourProm();
+    int band = 0;
+    for(int x = 0; x < 256; ++x){
+        while(band + 1 < machine->overlayBands && machine->overlay[band + 1].first <= x){
+            band++;
+        }
+        QRgb overlay = machine->overlayBands > 0 ? QColor(machine->overlay[band].colour).rgb()
+                                                 : QColor(Qt::white).rgb();
+        for(int row = 0; row < END_OF_SCREEN_LINE / 8; ++row){
+            if(prom){
+                uint8_t colour = colourProm[((row + 4) << 5) | (x >> 3)] & 7;   //0x2400 is row 4
+                screenColours[row][x] = qRgb(colour & 1 ? 255 : 0, colour & 4 ? 255 : 0,
+                                             colour & 2 ? 255 : 0);
+            }
+            else{
+                screenColours[row][x] = overlay;
+            }
+        }
+    }
+}
+
+//switches step between the block cache and single stepping, the Jit still comes first when it is on
+void Emulator::setBlockCache(bool enabled){
+    cpu.blockCacheEnabled = enabled;
+}
+
+//called from the gui thread after run has been stopped, so nothing else is touching cpu
+void Emulator::finish(){
+    trace.close();
+    audio.stop();
+    metricsExporter.stop();
+    if(sound->timing.writes > 0){
+        qDebug("Sound port writes: %llu, %llu played late (latest by %d samples), %llu resyncs",
+               (unsigned long long)sound->timing.writes, (unsigned long long)sound->timing.late,
+               sound->timing.latest, (unsigned long long)sound->timing.resyncs);
     }
-    else if(pixelPosition >= 192){
-        return Qt::red;
+    if(frameTiming.frames > 0){
+        double average = (double)frameTiming.cycles / frameTiming.frames;
+        qDebug("Emulated %llu frames at %.1f cycles each (shortest %d, longest %d), "
+               "the real machine runs %d, %+.2f%%",
+               (unsigned long long)frameTiming.frames, average, frameTiming.shortest,
+               frameTiming.longest, SCANLINES * CYCLES_PER_SCANLINE,
+               (average / (SCANLINES * CYCLES_PER_SCANLINE) - 1) * 100);
     }
-    else if(pixelPosition >= 72){
-        return Qt::white;
+    if(inputTiming.events > 0 || inputTiming.dropped > 0){
+        qDebug("Key presses: %llu, waited %.2f ms on average for an interrupt (longest %.2f ms), "
+               "%llu dropped",
+               (unsigned long long)inputTiming.events,
+               inputTiming.events ? inputTiming.totalNanoseconds / 1e6 / inputTiming.events : 0.0,
+               inputTiming.longestNanoseconds / 1e6, (unsigned long long)inputTiming.dropped);
     }
-    else if(pixelPosition >= 16){
-        return Qt::green;
+    latency.report();
+    QString latencyPath = Options::instance().latencyLogPath;
+    if(!latencyPath.isEmpty() && !latency.writeRecords(latencyPath)){
+        qWarning("Failed to write the latency records to %s", qPrintable(latencyPath));
     }
-    else{
-        return Qt::white;
+#ifdef CPU_PROFILING
+    writeProfile();
+#endif
+}
+
+//runs an interrupt's rst if the cpu has interrupts enabled, recording it first when tracing
+bool Emulator::interrupt(uint8_t opCode){
+    if(trace.isOpen() && cpu.enableInterrupts){
+        trace.record(cpu, opCode);
+    }
+    return cpu.generateInterrupt(opCode);
+}
+
+#ifdef CPU_PROFILING
+//writes the flat report and the folded stacks for a flamegraph next to each other
+void Emulator::writeProfile(){
+    QString path = Options::instance().profilePath;
+    if(!cpu.profiler.writeReport(path + ".txt") || !cpu.profiler.writeFoldedStacks(path + ".folded")){
+        qWarning("Failed to write the Cpu profile to %s", qPrintable(path));
     }
 }
+#endif
 
-//handles the key inputs for player controls
+//queues the key inputs for player controls, called on the gui thread so it leaves cpu alone and
+//the emulation takes the keys at its next interrupt
 void Emulator::inputHandler(const int key, bool pressed){
-    uint8_t bitsPlayer1 = 0;
-    uint8_t bitsPlayer2 = 0;
-    if(key == Qt::Key_A){
-        bitsPlayer1 = 1 << 5;               //player 1 left bit
+    InputEvent event = {key, pressed, hostNanoseconds()};
+    if(!inputEvents.push(event)){
+        inputTiming.dropped++;
     }
-    else if(key == Qt::Key_D){
-        bitsPlayer1 = 1 << 6;               //player 1 right bit
+}
+
+//takes the key presses queued since the last interrupt, in the order they were made
+void Emulator::takeInputs(){
+    InputEvent event;
+    int64_t now = hostNanoseconds();
+    while(inputEvents.pop(event)){
+        applyInput(event);
+        latency.inputTaken(event.key, event.pressed, event.time, now, shownFrames + 1);
+        int64_t wait = now - event.time;
+        inputTiming.events++;
+        inputTiming.totalNanoseconds += wait;
+        if(wait > inputTiming.longestNanoseconds){
+            inputTiming.longestNanoseconds = wait;
+        }
     }
-    else if(key == Qt::Key_1){
-        bitsPlayer1 = 1 << 2;               //player 1 start
+}
+
+//sets or clears the input bits the board binds a key to, player 2's only in a two player game
+void Emulator::applyInput(const InputEvent &event){
+    int key = event.key;
+    bool pressed = event.pressed;
+    if(key == Qt::Key_Tab){
+        setTurbo(pressed || turboAlways);   //fast forwards while held
+        return;
     }
-    else if(key == Qt::Key_2){
-        bitsPlayer1 = 1 << 1;               //2 player start
-        cpu.twoPlayer = true;
+    for(const KeyBinding *binding = machine->keys; binding->key != 0; ++binding){
+        if(binding->key != key){
+            continue;
+        }
+        if(binding->flags & KEY_TWO_PLAYER_START){
+            cpu.twoPlayer = true;
+        }
+        if((binding->flags & KEY_PLAYER_TWO) && !cpu.twoPlayer){
+            continue;
+        }
+        uint8_t *inputs[] = {&cpu.input0, &cpu.input1, &cpu.input2};
+        uint8_t &input = *inputs[binding->input];
+        if(pressed){
+            input = input | binding->bits;
+        }
+        else{
+            input = input & (binding->bits ^ 0xFF);
+        }
     }
-    else if(key == Qt::Key_W){
-        bitsPlayer1 = 1 << 4;               //player 1 fire
+}
+
+
+//passes a write to the sound port 3 on, stamped with the cycle it happened on, turbo mode is silent
+void Emulator::playSoundPort3(int raw){
+    if(!turbo){
+        sound->writePort(3, raw, emulatedCycles());
     }
-    else if(key == Qt::Key_C){
-        bitsPlayer1 = 1;                    //coin button
+}
+
+//passes a write to the sound port 5 on, stamped with the cycle it happened on, turbo mode is silent
+void Emulator::playSoundPort5(int raw){
+    if(!turbo){
+        sound->writePort(5, raw, emulatedCycles());
     }
-    else if(key == Qt::Key_Right){
-        bitsPlayer2 = 1 << 6;               //player 2 right
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Emulator::setTurbo(bool on)
+    ** Description: Starts or stops running as fast as the host allows. Turbo mode is silent, so
+        going into it writes 0 to both sound ports, which stops the repeating sounds, and
+        coming out of it writes the ports' real values, which also puts sound's mapping of
+        cycles to samples back in step after the cycles raced ahead.
+**************************************************************************************************/
+void Emulator::setTurbo(bool on){
+    if(on == turbo){
+        return;
     }
-    else if(key == Qt::Key_Left){
-        bitsPlayer2 = 1 << 5;               //player 2 left
+    turbo = on;
+    if(turbo){
+        sound->writePort(3, 0, emulatedCycles());
+        sound->writePort(5, 0, emulatedCycles());
     }
-    else if(key == Qt::Key_Up){
-        bitsPlayer2 = 1 << 4;               //player 2 fire
+    else{
+        writeSoundPorts();
     }
+}
 
-    if(pressed){
-        cpu.input1 = cpu.input1 | bitsPlayer1;
-        if(cpu.twoPlayer){
-            cpu.input2 = cpu.input2 | bitsPlayer2;
-        }
+//writes both sound ports again, which plays nothing new but (re)sets sound's mapping of cycles
+//to samples if it is not set or is far from this cycle
+void Emulator::writeSoundPorts(){
+    sound->writePort(3, cpu.output3, emulatedCycles());
+    sound->writePort(5, cpu.output5, emulatedCycles());
+}
+
+
+//copies the board's roms into memory and its colour prom, returns false if no good copy can be found
+bool Emulator::loadRom(){
+    if(!RomLoader::load(*machine, cpu.memory, colourProm)){
+        return false;
+    }
+    buildColours();
+    return true;
+}
+
+//emulate instructions, a whole basic block at a time when the block cache or Jit is on
+int Emulator::step(){
+    int cycles;
+    if(trace.isOpen()){
+        trace.record(cpu, cpu.memory[cpu.registers.pc]);
+        cycles = cpu.emulateInstruction();
+    }
+    else if(jit.enabled){
+        cycles = jit.run();
+    }
+    else if(cpu.blockCacheEnabled){
+        cycles = cpu.emulateBlock();
     }
     else{
-        cpu.input1 = cpu.input1  & (bitsPlayer1 ^ 0xFF);
-        if(cpu.twoPlayer){
-            cpu.input2 = cpu.input2  & (bitsPlayer2 ^ 0xFF);
-        }
+        cycles = cpu.emulateInstruction();
     }
+    frameCycles += cycles;
+    return cycles;
+}
+
+//the out instruction writing to a sound port is part of the step still running, so this is the
+//cycle that step started on, which is close enough as a block only runs for a sample or two
+uint64_t Emulator::emulatedCycles(){
+    return frameTiming.cycles + frameCycles;
+}
 
+//adds the cycles run since the last end of screen interrupt to frameTiming
+void Emulator::recordFrame(){
+    if(frameTiming.frames == 0 || frameCycles < frameTiming.shortest){
+        frameTiming.shortest = frameCycles;
+    }
+    if(frameCycles > frameTiming.longest){
+        frameTiming.longest = frameCycles;
+    }
+    frameTiming.last = frameCycles;
+    frameTiming.cycles += frameCycles;
+    frameTiming.frames++;
+    frameCycles = 0;
 }
 
 
+
 /**************************************************************************************************
- * Function Name: resetSound Emulator::playSoundPort3(int raw)
- * Description: Plays the appropriate sound file based on the current sound output
- * opcode sent to port 3.Function looks for the activated bit in the argument value to determine
- * which sound file to play.
+    ** Function Name: void Emulator::recordFrameMetrics()
+    ** Description: Adds the frame run just finished to Metrics: how its time since the end of
+        the last frame split into rendering, waiting on the clock and, the rest, running the
+        cpu, and its cycles. A frame that ends under half a frame after the last counts as
+        dropped, as a display refreshing at the cabinet's rate would only show one of the two,
+        and each whole frame period past the first that goes by without a frame counts as a
+        duplicate of the last one.
 **************************************************************************************************/
-void Emulator::playSoundPort3(int raw){
-    effect.setLoopCount(1);
-    if(raw & 1){
-        effect.setSource(QUrl("qrc:/sounds/ufo_highpitch.wav"));
-        effect.play();
+void Emulator::recordFrameMetrics(){
+    Metrics &metrics = Metrics::instance();
+    int64_t now = hostNanoseconds();
+    if(frameStarted != 0){
+        int64_t frameLength = (int64_t)SCANLINES * CYCLES_PER_SCANLINE * 1000000000 / CPU_CLOCK;
+        int64_t interval = now - frameStarted;
+        metrics.frameInterval.record(interval);
+        metrics.frameRender.record(renderNanoseconds);
+        metrics.frameWait.record(waitNanoseconds);
+        metrics.frameEmulation.record(interval - renderNanoseconds - waitNanoseconds);
+        if(interval < frameLength / 2){
+            metrics.framesDropped.add();
+        }
+        else if(interval > frameLength * 3 / 2){
+            metrics.framesDuplicated.add((interval + frameLength / 2) / frameLength - 1);
+        }
     }
-    else if((raw >> 1) & 1){
-        effect.setSource(QUrl("qrc:/sounds/shoot.wav"));
-        effect.play();
+    metrics.frames.add();
+    metrics.cycles.add(frameTiming.last);
+    frameStarted = now;
+    renderNanoseconds = 0;
+    waitNanoseconds = 0;
+}
 
+//returns the cycles from the last interrupt to the next one, the beam covers 134 lines on its way
+//round to the mid screen interrupt and 128 lines from there to the end of screen one
+int Emulator::halfFrameCycles(){
+    if(vBlank){
+        return (SCANLINES - END_OF_SCREEN_LINE + midScreenLine) * CYCLES_PER_SCANLINE;
     }
-    else if((raw >> 2) & 1 ){
-        effect.setSource(QUrl("qrc:/sounds/explosion.wav"));
-        effect.play();
+    return (END_OF_SCREEN_LINE - midScreenLine) * CYCLES_PER_SCANLINE;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: qint64 Emulator::halfFrameNanoseconds()
+    ** Description: Returns how long the half frame starting now should take with --audio-sync.
+        The audio output's clock, not the system timer, decides how fast the sound source uses
+        up the writes, so the emulation is held AUDIO_WRITE_DELAY samples ahead of the audio
+        being rendered, where the sound source expects writes to land. The averaged lead nudges
+        the half frame's length by up to AUDIO_SYNC_MAX_ADJUST, too little to see or hear but
+        enough to follow the difference between the two clocks, so the audio neither runs dry
+        nor drifts away. Until the audio is running the nominal length is used. A lead far
+        enough out that the sound source would remap on its next write, after a stall, is put
+        right at once by writing the sound ports.
+**************************************************************************************************/
+qint64 Emulator::halfFrameNanoseconds(){
+    qint64 nominal = (qint64)halfFrameCycles() * 1000000000 / CPU_CLOCK;
+    int64_t rendered = sound->renderedCycles();
+    if(!audio.isRunning() || rendered < 0){
+        return nominal;
     }
-    else if((raw >> 3) & 1 ){
-        effect.setSource(QUrl("qrc:/sounds/invaderkilled.wav"));
-        effect.play();
+
+    double lead = ((int64_t)emulatedCycles() - rendered) * (double)AUDIO_SAMPLE_RATE / CPU_CLOCK;
+    if(lead < -AUDIO_WRITE_DELAY || lead > AUDIO_WRITE_DELAY * AUDIO_RESYNC_LIMIT){
+        writeSoundPorts();
+        audioLead = AUDIO_WRITE_DELAY;
+        return nominal;
     }
+    audioLead += (lead - audioLead) / AUDIO_SYNC_SMOOTHING;
+    double adjust = (audioLead - AUDIO_WRITE_DELAY) / AUDIO_WRITE_DELAY * AUDIO_SYNC_MAX_ADJUST;
+    adjust = qBound(-AUDIO_SYNC_MAX_ADJUST, adjust, AUDIO_SYNC_MAX_ADJUST);
+    return nominal * (1 + adjust);
 }
 
+//returns the line the emulated beam is on, worked out from the cycles left until the next interrupt
+int Emulator::scanline(){
+    int interruptLine = vBlank ? midScreenLine : END_OF_SCREEN_LINE;
+    int position = interruptLine * CYCLES_PER_SCANLINE - cyclesUntilInterrupt;
+    position %= SCANLINES * CYCLES_PER_SCANLINE;
+    if(position < 0){
+        position += SCANLINES * CYCLES_PER_SCANLINE;
+    }
+    return position / CYCLES_PER_SCANLINE;
+}
+
+
 /**************************************************************************************************
- * Function Name: resetSound Emulator::playSoundPort5(int raw)
- * Description: Plays the appropriate sound file based on the current sound output
- * opcode sent to port 5. Function looks for the activated bit in the argument value to determine
- * which sound file to play.
+    ** Function Name: bool Emulator::endHalfFrame()
+    ** Description: Sends one of the 2 interrupts, the one that's different from the last one
+        sent, once the beam reaches its line: the board's mid screen one, rst 1 at line 96 on
+        every board so far, and its end of screen one, rst 2 at line 224. The screen is shown
+        along with the end of screen interrupt, as that means a frame is done being generated
+        in video RAM, painting whatever lines paintDueLines has not already
+        done, unless turbo mode is skipping the frame. This happens on the first try only, as
+        the beam has left the screen by then. The key presses that arrived during the half
+        frame are taken next. If the cpu has interrupts disabled nothing else changes and false
+        is returned, so the caller keeps running instructions and tries again. The rst's own
+        cycles are charged and the cycles run past the interrupt's line come out of the next
+        half frame, so the beam stays in step with the cycles run.
 **************************************************************************************************/
-void Emulator::playSoundPort5(int raw){
-    effect.setLoopCount(1);
-    if(raw & 1){
-        QSound::play(QString("qrc:/sounds/fastinvader1.wav"));
+bool Emulator::endHalfFrame(){
+    uint8_t opCode = vBlank ? machine->midScreenOpcode : machine->endOfScreenOpcode;
+    bool interruptSuccessful = interrupt(opCode);
+    if(vBlank){
+        if(showFrame){
+            paintDueLines();
+        }
     }
-    else if((raw >> 1) & 1){
-        QSound::play(QString("qrc:/sounds/fastinvader2.wav"));
+    else if(!frameEnded){
+        frameEnded = true;
+        if(showFrame){
+            paintLines(paintedLine, END_OF_SCREEN_LINE);
+            paintedLine = END_OF_SCREEN_LINE;
+            showScreen();
+        }
+#ifdef CPU_PROFILING
+        if(--framesUntilProfile == 0){
+            writeProfile();
+            framesUntilProfile = PROFILE_INTERVAL;
+        }
+#endif
     }
-    else if((raw >> 2) & 1){
-        QSound::play(QString("qrc:/sounds/fastinvader3.wav"));
+    takeInputs();                           //after the screen, which was made without them
+
+    if(interruptSuccessful){
+        //an interrupt held off for more than a half frame does not make the next one early
+        if(cyclesUntilInterrupt < -halfFrameCycles()){
+            cyclesUntilInterrupt = 0;
+        }
+        frameCycles += cpu.cycleTable[opCode];
+        cyclesUntilInterrupt -= cpu.cycleTable[opCode];
+
+        // move the cycle counter on to the next interrupt's line and flip VBI tracker
+        if(!vBlank){
+            recordFrame();
+            paintedLine = 0;
+            frameEnded = false;
+            //turbo mode only shows frames as often as the cabinet's screen would
+            showFrame = !turbo || hostNanoseconds() - lastShown >=
+                        (int64_t)SCANLINES * CYCLES_PER_SCANLINE * 1000000000 / CPU_CLOCK;
+        }
+        vBlank = !vBlank;
+        cyclesUntilInterrupt += halfFrameCycles();
+        schedulePaint();
+    }
+    return interruptSuccessful;
+}
+
+//returns the line the screen is next painted up to after line, each batch is painted once the
+//beam has passed all of its lines
+int Emulator::nextPaintLine(int line){
+    if(renderLines > 0){
+        return qMin(line + renderLines, END_OF_SCREEN_LINE);
     }
-    else if((raw >> 3) & 1){
-        QSound::play(QString("qrc:/sounds/fastinvader4.wav"));
+    if(renderHalves && line < midScreenLine){
+        return midScreenLine;
     }
-    else if((raw >> 4) & 1){
-        effect.setSource(QUrl("qrc:/sounds/ufo_lowpitch.wav"));
-        effect.play();
+    return END_OF_SCREEN_LINE;
+}
+
+//sets paintDue to the value cyclesUntilInterrupt has when the next batch of lines is due, or to 0
+//when the next batch is painted along with the coming interrupt or the frame is not shown
+void Emulator::schedulePaint(){
+    if(!showFrame){
+        paintDue = 0;
+        return;
     }
+    int interruptLine = vBlank ? midScreenLine : END_OF_SCREEN_LINE;
+    int line = nextPaintLine(paintedLine);
+    paintDue = line < interruptLine ? (interruptLine - line) * CYCLES_PER_SCANLINE : 0;
 }
 
 
-//opens the proper rom file and emulates Space Invaders Game, called on start instruction in Gui class
-void Emulator::run(){
+/**************************************************************************************************
+    ** Function Name: void Emulator::paintDueLines()
+    ** Description: Paints every batch of lines the beam has finished since the last batch, then
+        schedules the next one. Called from the emulation loops when cyclesUntilInterrupt falls
+        to paintDue, so with --render-lines the cost of converting video RAM is spread over the
+        frame and only the last batch is left to do when the screen is shown.
+**************************************************************************************************/
+void Emulator::paintDueLines(){
+    int beam = scanline();
+    int line = paintedLine;
+    while(line < END_OF_SCREEN_LINE && nextPaintLine(line) <= beam){
+        line = nextPaintLine(line);
+    }
+    if(line > paintedLine){
+        paintLines(paintedLine, line);
+        paintedLine = line;
+    }
+    schedulePaint();
+}
 
-    QFile rom("../roms/invaders.rom");
-    if(!rom.open(QIODevice::ReadOnly)){
-        qFatal("Falied to open the rom file");
+//runs the emulator until both of a frame's interrupts have been sent, as fast as the host allows
+void Emulator::emulateFrame(){
+    int interruptsSent = 0;
+    while(interruptsSent < 2){
+        if(cyclesUntilInterrupt <= paintDue){
+            if(cyclesUntilInterrupt > 0){
+                paintDueLines();
+            }
+            else if(endHalfFrame()){
+                interruptsSent++;
+                continue;
+            }
+        }
+        cyclesUntilInterrupt -= step();
     }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: QByteArray Emulator::saveSnapshot()
+    ** Description: Saves everything needed to carry on emulating from this point: the registers,
+        flags, I/O latches, the position in the frame and all 64K of memory, after a magic
+        string that also marks the layout's version.
+**************************************************************************************************/
+QByteArray Emulator::saveSnapshot(){
+    QByteArray snapshot;
+    QDataStream out(&snapshot, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out.writeRawData(SNAPSHOT_MAGIC, 8);
+    out << cpu.registers.b << cpu.registers.c << cpu.registers.d << cpu.registers.e
+        << cpu.registers.h << cpu.registers.l << cpu.registers.a
+        << cpu.registers.pc << cpu.registers.sp << cpu.flags.getRegisterValue();
+    out << cpu.enableInterrupts << cpu.twoPlayer
+        << cpu.input0 << cpu.input1 << cpu.input2
+        << cpu.output3 << cpu.output5 << cpu.output6
+        << cpu.shifter.contents << cpu.shifter.amount;
+    out << (qint32)cyclesUntilInterrupt << vBlank;
+    out.writeRawData((const char*)cpu.memory, 0x10000);
+    return snapshot;
+}
 
-    //create byte array for the data
-    QByteArray romData = rom.readAll();
-    Q_ASSERT(romData.size() == 0x2000);
 
-    rom.close();
-    for(int i = 0; i < 0x2000; i++){
-        cpu.memory[i] = romData.at(i);
+/**************************************************************************************************
+    ** Function Name: bool Emulator::loadSnapshot(const QByteArray &snapshot)
+    ** Description: Puts the machine back into the state saved by saveSnapshot. Nothing is changed
+        unless the whole snapshot reads back, and false is returned for anything that is not a
+        snapshot of this version. Cached blocks are dropped as the code in memory may differ.
+**************************************************************************************************/
+bool Emulator::loadSnapshot(const QByteArray &snapshot){
+    QDataStream in(snapshot);
+    in.setVersion(QDataStream::Qt_5_0);
+    char magic[8];
+    if(in.readRawData(magic, 8) != 8 || memcmp(magic, SNAPSHOT_MAGIC, 8) != 0){
+        return false;
     }
 
-    //start timer
+    Cpu::State8080Registers registers;
+    uint8_t flags;
+    bool enableInterrupts, twoPlayer, savedVBlank;
+    uint8_t inputs[3], outputs[3], shiftAmount;
+    uint16_t shift;
+    qint32 cycles;
+    in >> registers.b >> registers.c >> registers.d >> registers.e
+       >> registers.h >> registers.l >> registers.a
+       >> registers.pc >> registers.sp >> flags;
+    in >> enableInterrupts >> twoPlayer
+       >> inputs[0] >> inputs[1] >> inputs[2]
+       >> outputs[0] >> outputs[1] >> outputs[2]
+       >> shift >> shiftAmount;
+    in >> cycles >> savedVBlank;
+    QByteArray memory(0x10000, 0);
+    if(in.readRawData(memory.data(), 0x10000) != 0x10000 || in.status() != QDataStream::Ok){
+        return false;
+    }
+
+    cpu.registers = registers;
+    cpu.flags = Flags(flags);
+    cpu.enableInterrupts = enableInterrupts;
+    cpu.twoPlayer = twoPlayer;
+    cpu.input0 = inputs[0];
+    cpu.input1 = inputs[1];
+    cpu.input2 = inputs[2];
+    cpu.output3 = outputs[0];
+    cpu.output5 = outputs[1];
+    cpu.output6 = outputs[2];
+    cpu.shifter.contents = shift;
+    cpu.shifter.amount = shiftAmount & 7;
+    cyclesUntilInterrupt = cycles;
+    vBlank = savedVBlank;
+    memcpy(cpu.memory, memory.constData(), 0x10000);
+    cpu.blockCache.clear();
+    paintedLine = 0;                //the lines the beam has passed are painted on the next check
+    frameEnded = false;
+    schedulePaint();
+
+    //the sounds follow the loaded ports as if the game had just written them
+    writeSoundPorts();
+    return true;
+}
+
+//opens the proper rom file and emulates Space Invaders Game, called on start instruction in Gui class,
+//returns once the Gui asks the thread to stop with requestInterruption
+void Emulator::run(){
+    if(!loadRom()){
+        qFatal("Failed to load the rom, see --rom-path");
+    }
+
+    //every sound is decoded before the game starts, the game runs silently if any is missing
+    if(sound == &synth || mixer.load()){
+        audio.start();
+    }
+    if(metricsExporter.isEnabled()){
+        metricsExporter.start();
+    }
+
+    //start timer, with --audio-sync it counts towards the time the next interrupt is due
     QElapsedTimer frameTimer;
-    //start cycle counter
-    int cyclesUntilInterrupt = MAX_CYCLES;
-    bool vBlank = true;
+    frameTimer.start();
+    qint64 interruptDue = 0;
+    if(audioSync){
+        writeSoundPorts();
+    }
     while(true){
-        //check if max cycles has been reached
-        if(cyclesUntilInterrupt <= 0){
-            if(frameTimer.nsecsElapsed() < HALF_FRAME){
+        //paint the lines the beam has finished, or check if max cycles has been reached
+        if(cyclesUntilInterrupt <= paintDue && cyclesUntilInterrupt > 0){
+            paintDueLines();
+        }
+        else if(cyclesUntilInterrupt <= 0){
+            // the Gui asks the thread to stop when it closes, checked once per half frame and on
+            // every pass while waiting for the next interrupt
+            if(isInterruptionRequested()){
+                break;
+            }
+            if(turbo){
+                // fast forwarding, the next interrupt is due as soon as the beam gets there
+            }
+            else if(audioSync){
+                // sleep instead of spinning, the time is kept from interrupt to interrupt so
+                // oversleeping one half frame comes out of the next
+                qint64 wait = interruptDue - frameTimer.nsecsElapsed();
+                if(wait > 0){
+                    if(waitStarted == 0){
+                        waitStarted = hostNanoseconds();
+                    }
+                    usleep(wait / 1000);
+                    continue;
+                }
+            }
+            else if(frameTimer.nsecsElapsed() < (qint64)halfFrameCycles() * 1000000000 / CPU_CLOCK){
                 // if enough cycles have been executed, but not enough time has passed,
                 // do not execute any more instructions until enough time has passed
+                if(waitStarted == 0){
+                    waitStarted = hostNanoseconds();
+                }
                 continue;
             }
+            if(waitStarted != 0){
+                waitNanoseconds += hostNanoseconds() - waitStarted;
+                waitStarted = 0;
+            }
 
             // once enough cycles per half frame have been done, and enough time has passed
-            // send one of the 2 interrupts, the one that's different from the last interrupt sent
-            bool interruptSuccessful;
-            if(vBlank){
-                interruptSuccessful = cpu.generateInterrupt(0xCF);
+            // send the next interrupt and restart the timer if the cpu took it
+            if(endHalfFrame()){
+                if(audioSync && !turbo){
+                    // a run that fell more than a half frame behind, say while the window was
+                    // dragged, carries on from there rather than rushing to catch up
+                    qint64 length = halfFrameNanoseconds();
+                    interruptDue = qMax(interruptDue, frameTimer.nsecsElapsed() - length) + length;
+                }
+                else{
+                    frameTimer.restart();
+                }
+                if(vBlank){
+                    recordFrameMetrics();       //the end of screen interrupt finished a frame
+                }
             }
             else{
-                // When sending VBI, also paint screen, as that means one frame is done being generated in video RAM
-                interruptSuccessful = cpu.generateInterrupt(0xD7);
-                paintScreen();
-            }
-
-            if(interruptSuccessful){
-                // restart timer, reset cycle counter, and flip VBI tracker on successful interrupt
-                vBlank = !vBlank;
-                cyclesUntilInterrupt = MAX_CYCLES;
-                frameTimer.restart();
+                Metrics::instance().interruptRetries.add();
             }
         }
-        //emulate instructions
-        int cycles = cpu.emulateInstruction();
-        cyclesUntilInterrupt -= cycles;
+        cyclesUntilInterrupt -= step();
     }
 }
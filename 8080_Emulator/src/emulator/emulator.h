@@ -4,35 +4,132 @@
 **************************************************************************************************/
 #include <QWidget>
 #include <QThread>
-#include <QtMultimedia/QMediaPlayer>
-#include <QtMultimedia/QSoundEffect>
 
+#include "../audio/audioMixer.h"
+#include "../audio/audioThread.h"
+#include "../audio/soundSynth.h"
+#include "../concurrency/spscQueue.h"
 #include "../cpu/cpu.h"
+#include "../jit/jit.h"
+#include "../latency/latencyMonitor.h"
+#include "../metrics/metricsExporter.h"
+#include "../trace/traceWriter.h"
 
 #ifndef EMULATOR_H
 #define EMULATOR_H
 
+const int INPUT_QUEUE_SLOTS = 64;           //key presses that can wait for the next interrupt
 
 class Emulator : public QThread
 {
     Q_OBJECT
 public:
     Emulator();                             //constructor
+    bool loadRom();                         //copies the game rom into memory, false if it is missing
+    void emulateFrame();                    //runs one frame without waiting on the clock
+    void paintScreen();
+    int scanline();                         //the line the emulated beam is on
+    QByteArray saveSnapshot();              //the whole machine state, see loadSnapshot
+    bool loadSnapshot(const QByteArray &snapshot);
+    void finish();                          //saves what is kept until exit, once run has stopped
+    void setBlockCache(bool enabled);       //runs the Cpu a block at a time, or single steps it
+#ifdef CPU_PROFILING
+    void writeProfile();                    //saves the Cpu profile to the files given by --profile
+#endif
+
+    //cycles run in each frame, from one end of screen interrupt to the next
+    struct FrameTiming{
+        uint64_t frames;
+        uint64_t cycles;
+        int shortest;
+        int longest;
+        int last;
+    } frameTiming;
+
+    //how long key presses waited between arriving from the gui and the emulation taking them
+    struct InputTiming{
+        uint64_t events;
+        int64_t totalNanoseconds;
+        int64_t longestNanoseconds;
+        uint64_t dropped;                   //presses lost to a full queue, counted by the gui thread
+    } inputTiming;
+    LatencyMonitor latency;                 //times presses from inputHandler to the gui's screen
 private:
     Cpu cpu;
+    Jit jit;                                //optional native code backend for cpu
+    TraceWriter trace;                      //records every instruction when --trace is given
+    AudioMixer mixer;                       //sounds triggered by the cpu's port writes
+    SoundSynth synth;                       //makes the sounds instead of mixer with --synth-sound
+    SoundSource *sound;                     //mixer, or synth with --synth-sound
+    AudioThread audio;                      //plays sound, started by run
+    bool audioSync;                         //paces run from the audio clock, see halfFrameNanoseconds
+    MetricsExporter metricsExporter;        //serves Metrics, started by run when asked for
+    double audioLead;                       //samples the emulation runs ahead of the audio, averaged
+
+    const Machine *machine;                 //the board being emulated, picked with --machine
+    uint8_t colourProm[COLOUR_PROM_SIZE];   //the board's colour proms, if it has any
+    QRgb screenColours[224 / 8][256];       //colour of a lit pixel, per block of 8 lines and x
+    int midScreenLine;                      //line the beam is on when the mid screen interrupt fires
 
     QImage originalScreen;                  //screen in its original form
     QImage rotatedScreen;                   //screen displayed to the user
     QTransform transform;                   //transformation factor for the screen
 
-    void paintScreen();
-    QColor paintPixel(int pixelPosition);
-    void resetSound();                      // Used to control sound setting
+    int cyclesUntilInterrupt;               //cycles left in the current half frame
+    bool vBlank;                            //true when the next interrupt is the mid screen one
+    int frameCycles;                        //cycles run since the last end of screen interrupt
+    bool renderHalves;                      //paint each half of the screen as the beam passes it
+    int renderLines;                        //lines painted at a time as the beam passes, 0 for off
+    int paintedLine;                        //lines above this are painted for the current frame
+    int paintDue;                           //cyclesUntilInterrupt when the next batch is painted
+    uint64_t shownFrames;                   //frames sent to the gui, each numbered by the count
+    bool frameEnded;                        //the end of screen interrupt has been tried this frame
+
+    //where the time of the frame run is working on has gone so far, for Metrics
+    int64_t frameStarted;                   //host time the frame began, 0 before the first
+    int64_t renderNanoseconds;              //spent in paintLines and showScreen
+    int64_t waitNanoseconds;                //spent waiting for interrupts to be due
+    int64_t waitStarted;                    //host time run began waiting, 0 when it is not
+
+    bool turbo;                             //running flat out, with Tab held or --turbo
+    bool turboAlways;                       //--turbo, turbo mode for the whole run
+    bool showFrame;                         //false while turbo mode skips the frame being run
+    int64_t lastShown;                      //host time showScreen last sent a frame
+
+    //a key press or release, stamped with the host time it reached inputHandler
+    struct InputEvent{
+        int key;
+        bool pressed;
+        int64_t time;
+    };
+    SpscQueue<InputEvent, INPUT_QUEUE_SLOTS> inputEvents;   //from the gui thread to the emulation
+#ifdef CPU_PROFILING
+    int framesUntilProfile;
+#endif
+
+    void buildColours();                    //fills in screenColours for the board
+    void paintLines(int first, int last);   //paints screen lines first up to last from video ram
+    void showScreen();                      //sends the painted screen to the gui
+    int nextPaintLine(int line);
+    void schedulePaint();
+    void paintDueLines();                   //paints the lines the beam has finished
+    void applyInput(const InputEvent &event);   //sets or clears the event's input port bit
+    void takeInputs();                      //applies every key press waiting on inputEvents
+    bool interrupt(uint8_t opCode);         //sends an interrupt to cpu, tracing it when recording
+    int step();                             //runs the next instruction or block
+    uint64_t emulatedCycles();              //cycles run since the emulator was made
+    void writeSoundPorts();                 //hands both sound ports to sound as they are now
+    void setTurbo(bool on);
+    int halfFrameCycles();                  //cycles between the last interrupt and the next
+    qint64 halfFrameNanoseconds();          //how long run takes over the next half frame
+    bool endHalfFrame();                    //sends the interrupt due at the end of a half frame
+    void recordFrame();                     //adds the frame just finished to frameTiming
+    void recordFrameMetrics();              //adds the frame run just finished to Metrics
 
     void run();
 
 signals:
-    void screenIsUpdated(QImage const*);    //signal sent to gui that screen changed
+    void screenIsUpdated(QImage const*, quint64 frame);     //signal sent to gui that screen changed
 
 public slots:
     void inputHandler(const int key, bool pressed);
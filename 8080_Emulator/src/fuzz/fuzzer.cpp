@@ -0,0 +1,437 @@
+/**************************************************************************************************
+    ** File Name: fuzzer.cpp
+    ** Description: Contains the member function definitions for the Fuzzer class.
+**************************************************************************************************/
+#include <QTextStream>
+#include <string.h>
+
+#include "fuzzer.h"
+#include "../options/options.h"
+
+static const char *ENGINE_NAMES[] = {"decoder", "handlers", "blocks", "jit"};
+
+
+/**************************************************************************************************
+    ** Function Name: Fuzzer::Fuzzer(uint32_t seed)
+    ** Description: The constructor for the Fuzzer class. The same seed always produces the same
+        cases, so a mismatch can be reproduced by running again with the seed that was reported.
+**************************************************************************************************/
+Fuzzer::Fuzzer(uint32_t seed) : seed(seed), jit(&cpu)
+{
+    state = seed ^ 0x9E3779B9;
+    if(state == 0){
+        state = 1;
+    }
+    startMemory = new uint8_t[0x10000];
+    singleMemory = new uint8_t[0x10000];
+    interpreterSingleMemory = new uint8_t[0x10000];
+    interpreterBlockMemory = new uint8_t[0x10000];
+    caseNumber = 0;
+    cpu.setStrictTiming(Options::instance().strictTiming);
+    memset(mismatches, 0, sizeof(mismatches));
+    memset(divergences, 0, sizeof(divergences));
+    memset(runs, 0, sizeof(runs));
+}
+
+
+/**************************************************************************************************
+    ** Function Name: Fuzzer::~Fuzzer()
+    ** Description: Destructor for the Fuzzer class, frees the saved memory images.
+**************************************************************************************************/
+Fuzzer::~Fuzzer(){
+    delete[] startMemory;
+    delete[] singleMemory;
+    delete[] interpreterSingleMemory;
+    delete[] interpreterBlockMemory;
+}
+
+//xorshift32, fast and good enough to spread cases over every opcode and operand
+uint32_t Fuzzer::random(){
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Fuzzer::makeCase()
+    ** Description: Builds the next case: random registers, flags, inputs, outputs and shift
+        register contents, with port 3 reading what the shift register gives for them, and an
+        opcode other than HLT at a random pc followed by a JMP, so the block engines stop after
+        it. The pc is kept low enough that neither the instruction nor the JMP wraps past the top
+        of memory. IN and OUT are given the ports the Space Invaders board has. Memory is only
+        filled with new random bytes every FUZZ_MEMORY_REFRESH cases as that is the slow part,
+        the random registers point each case at different bytes anyway.
+**************************************************************************************************/
+void Fuzzer::makeCase(){
+    if(caseNumber++ % FUZZ_MEMORY_REFRESH == 0){
+        for(int i = 0; i < 0x10000; i += 4){
+            uint32_t bytes = random();
+            memcpy(&startMemory[i], &bytes, 4);
+        }
+    }
+
+    uint8_t opcode;
+    do{
+        opcode = random();
+    }while(opcode == 0x76);
+
+    memset(&startRegisters, 0, sizeof(startRegisters));
+    startRegisters.bc = random();
+    startRegisters.de = random();
+    startRegisters.hl = random();
+    startRegisters.sp = random();
+    startRegisters.a = random();
+    startRegisters.pc = random() % 0xFFF8;
+    startFlags = (random() & (SIGN_BIT | ZERO_BIT | AUX_BIT | PARITY_BIT | CARRY_BIT)) | EMPTY_FLAG;
+    startInterrupts = random() & 1;
+    for(int port = 0; port < 3; ++port){
+        startInputs[port] = random();
+    }
+    for(int port = 0; port < 7; ++port){
+        startOutputs[port] = random();
+    }
+    startShift = random();
+    startShiftAmount = random() & 7;
+    startInputs[3] = startShift >> (8 - startShiftAmount);
+
+    uint16_t pc = startRegisters.pc;
+    startMemory[pc] = opcode;
+    if(opcode == 0xDB){
+        startMemory[pc + 1] = 1 + random() % 3;
+    }
+    else if(opcode == 0xD3){
+        startMemory[pc + 1] = 2 + random() % 5;
+    }
+    startMemory[pc + BlockCache::length(opcode)] = 0xC3;
+}
+
+//puts the case's starting state into the Cpu
+void Fuzzer::loadCpu(){
+    cpu.registers = startRegisters;
+    cpu.flags = Flags(startFlags);
+    cpu.enableInterrupts = startInterrupts;
+    cpu.input0 = startInputs[0];
+    cpu.input1 = startInputs[1];
+    cpu.input2 = startInputs[2];
+    cpu.output3 = startOutputs[3];
+    cpu.output5 = startOutputs[5];
+    cpu.output6 = startOutputs[6];
+    cpu.shifter.contents = startShift;
+    cpu.shifter.amount = startShiftAmount;
+    memcpy(cpu.memory, startMemory, 0x10000);
+}
+
+//collects the state the Cpu was left in
+void Fuzzer::readCpu(Outcome &outcome, int cycles){
+    outcome.bc = cpu.registers.bc;
+    outcome.de = cpu.registers.de;
+    outcome.hl = cpu.registers.hl;
+    outcome.sp = cpu.registers.sp;
+    outcome.pc = cpu.registers.pc;
+    outcome.a = cpu.registers.a;
+    outcome.flags = cpu.flags.getRegisterValue();
+    outcome.interrupts = cpu.enableInterrupts;
+    memset(outcome.outputs, 0, sizeof(outcome.outputs));
+    outcome.outputs[3] = cpu.output3;
+    outcome.outputs[5] = cpu.output5;
+    outcome.outputs[6] = cpu.output6;
+    outcome.shift = cpu.shifter.contents;
+    outcome.shiftAmount = cpu.shifter.amount;
+    outcome.cycles = cycles;
+    outcome.memory = cpu.memory;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Fuzzer::readReference(Outcome &outcome, int cycles)
+    ** Description: Collects the state the ReferenceCpu was left in. The reference only records
+        an OUT, so the board's side of it is worked out here: port 2 sets the shift amount, port 4
+        shifts a byte into the top of the shift register, pushing the previous one down, and the
+        other ports latch the value.
+**************************************************************************************************/
+void Fuzzer::readReference(Outcome &outcome, int cycles){
+    outcome.bc = (reference.b << 8) | reference.c;
+    outcome.de = (reference.d << 8) | reference.e;
+    outcome.hl = (reference.h << 8) | reference.l;
+    outcome.sp = reference.sp;
+    outcome.pc = reference.pc;
+    outcome.a = reference.a;
+    outcome.flags = reference.f;
+    outcome.interrupts = reference.interrupts;
+    memset(outcome.outputs, 0, sizeof(outcome.outputs));
+    outcome.outputs[3] = startOutputs[3];
+    outcome.outputs[5] = startOutputs[5];
+    outcome.outputs[6] = startOutputs[6];
+    outcome.shift = startShift;
+    outcome.shiftAmount = startShiftAmount;
+    switch(reference.outPort){
+    case 2:
+        outcome.shiftAmount = reference.outValue & 7;
+        break;
+    case 4:
+        outcome.shift = (reference.outValue << 8) | (startShift >> 8);
+        break;
+    case 3:
+    case 5:
+    case 6:
+        outcome.outputs[reference.outPort] = reference.outValue;
+        break;
+    }
+    outcome.cycles = cycles;
+    outcome.memory = reference.memory;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Fuzzer::runReference(Outcome &single, Outcome &block)
+    ** Description: Runs the case on the ReferenceCpu. single is the state after the instruction,
+        which the decoder and handlers are held to. block is the state the block engines should
+        reach: the trailing JMP runs as well unless the instruction branched, or wrote over the
+        block's own bytes, which makes the block cache stop and decode the new code next time.
+**************************************************************************************************/
+void Fuzzer::runReference(Outcome &single, Outcome &block){
+    reference.b = startRegisters.b;
+    reference.c = startRegisters.c;
+    reference.d = startRegisters.d;
+    reference.e = startRegisters.e;
+    reference.h = startRegisters.h;
+    reference.l = startRegisters.l;
+    reference.a = startRegisters.a;
+    reference.sp = startRegisters.sp;
+    reference.pc = startRegisters.pc;
+    reference.f = startFlags;
+    reference.interrupts = startInterrupts;
+    reference.halted = false;
+    reference.outPort = -1;
+    for(int port = 0; port < 4; ++port){
+        reference.inputs[port] = startInputs[port];
+    }
+    memcpy(reference.memory, startMemory, 0x10000);
+
+    uint16_t pc = startRegisters.pc;
+    uint8_t opcode = startMemory[pc];
+    int cycles = reference.step();
+    memcpy(singleMemory, reference.memory, 0x10000);
+    readReference(single, cycles);
+    single.memory = singleMemory;
+
+    bool stopped = BlockCache::endsBlock(opcode);
+    uint16_t blockEnd = pc + BlockCache::length(opcode) + 3;
+    for(int i = 0; i < reference.writeCount && i < 2; ++i){
+        if(reference.writes[i] >= pc && reference.writes[i] < blockEnd){
+            stopped = true;
+        }
+    }
+    if(!stopped){
+        cycles += reference.step();
+    }
+    readReference(block, cycles);
+    blockStops = stopped;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Fuzzer::runInterpreter(Outcome &single, Outcome &block)
+    ** Description: Runs the case through getInstruction, the single-step interpreter, which the
+        other engines are held to. single is the state after the instruction and block the state
+        after the trailing JMP as well, which is run whenever it was run on the reference.
+**************************************************************************************************/
+void Fuzzer::runInterpreter(Outcome &single, Outcome &block){
+    loadCpu();
+    uint8_t opcode = startMemory[startRegisters.pc];
+    int cycles = cpu.chargeCycles(opcode, cpu.getInstruction(opcode));
+    memcpy(interpreterSingleMemory, cpu.memory, 0x10000);
+    readCpu(single, cycles);
+    single.memory = interpreterSingleMemory;
+
+    if(!blockStops){
+        uint8_t next = cpu.memory[cpu.registers.pc];
+        cycles += cpu.chargeCycles(next, cpu.getInstruction(next));
+    }
+    memcpy(interpreterBlockMemory, cpu.memory, 0x10000);
+    readCpu(block, cycles);
+    block.memory = interpreterBlockMemory;
+}
+
+//runs the case on one of the Cpu's engines other than the decoder and returns the cycles it reported
+int Fuzzer::runEngine(Engine engine){
+    uint8_t opcode = startMemory[startRegisters.pc];
+    switch(engine){
+    case HANDLERS:
+        loadCpu();
+        return cpu.chargeCycles(opcode, cpu.executeOpcode(opcode));
+    case BLOCKS:
+        loadCpu();
+        return cpu.emulateBlock();
+    default:
+    {
+        //enter the block until it is hot so the last run is native, if the Jit translates it
+        int cycles = 0;
+        for(int i = 0; i < HOT_BLOCK_THRESHOLD; ++i){
+            loadCpu();
+            cycles = jit.run();
+        }
+        return cycles;
+    }
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: QString Fuzzer::compare(const Outcome &actual, const Outcome &expected)
+    ** Description: Lists every field where actual differs from expected as "field actual
+        expected value", or returns an empty string if they match. Only the first differing
+        memory address is named.
+**************************************************************************************************/
+QString Fuzzer::compare(const Outcome &actual, const Outcome &expected){
+    QString differences;
+    auto check = [&differences](const char *name, int value, int expectedValue, int width){
+        if(value != expectedValue){
+            differences += QString("%1 0x%2 expected 0x%3, ").arg(name)
+                    .arg(value, width, 16, QChar('0')).arg(expectedValue, width, 16, QChar('0'));
+        }
+    };
+    check("a", actual.a, expected.a, 2);
+    check("flags", actual.flags, expected.flags, 2);
+    check("bc", actual.bc, expected.bc, 4);
+    check("de", actual.de, expected.de, 4);
+    check("hl", actual.hl, expected.hl, 4);
+    check("sp", actual.sp, expected.sp, 4);
+    check("pc", actual.pc, expected.pc, 4);
+    check("interrupts", actual.interrupts, expected.interrupts, 1);
+    check("port 3", actual.outputs[3], expected.outputs[3], 2);
+    check("port 5", actual.outputs[5], expected.outputs[5], 2);
+    check("port 6", actual.outputs[6], expected.outputs[6], 2);
+    check("shift", actual.shift, expected.shift, 4);
+    check("shift amount", actual.shiftAmount, expected.shiftAmount, 1);
+    if(actual.cycles != expected.cycles){
+        differences += QString("cycles %1 expected %2, ").arg(actual.cycles).arg(expected.cycles);
+    }
+    for(int address = 0; address < 0x10000; ++address){
+        if(actual.memory[address] != expected.memory[address]){
+            differences += QString("memory[0x%1] 0x%2 expected 0x%3, ")
+                    .arg(address, 4, 16, QChar('0'))
+                    .arg(actual.memory[address], 2, 16, QChar('0'))
+                    .arg(expected.memory[address], 2, 16, QChar('0'));
+            break;
+        }
+    }
+    differences.chop(2);
+    return differences;
+}
+
+//describes the starting state of the current case, enough to set it up again by hand
+QString Fuzzer::describeCase(){
+    uint16_t pc = startRegisters.pc;
+    return QString("pc 0x%1 bytes %2 %3 %4, a 0x%5 flags 0x%6 bc 0x%7 de 0x%8 hl 0x%9 sp 0x%10")
+            .arg(pc, 4, 16, QChar('0'))
+            .arg(startMemory[pc], 2, 16, QChar('0'))
+            .arg(startMemory[pc + 1], 2, 16, QChar('0'))
+            .arg(startMemory[pc + 2], 2, 16, QChar('0'))
+            .arg(startRegisters.a, 2, 16, QChar('0'))
+            .arg(startFlags, 2, 16, QChar('0'))
+            .arg(startRegisters.bc, 4, 16, QChar('0'))
+            .arg(startRegisters.de, 4, 16, QChar('0'))
+            .arg(startRegisters.hl, 4, 16, QChar('0'))
+            .arg(startRegisters.sp, 4, 16, QChar('0'));
+}
+
+
+/**************************************************************************************************
+    ** Function Name: int Fuzzer::run(int cases)
+    ** Description: Runs the given number of cases on the reference and on every engine, then
+        prints each opcode an engine got wrong with how often it happened, the first difference
+        and the case it came from, first against the reference and then against the decoder.
+        The Jit is left out when it cannot start on this host. Returns 0 if no engine differed
+        from the decoder and 1 otherwise, for use as the program's exit code. Differences from
+        the reference are only reported, the core already has some of its own.
+**************************************************************************************************/
+int Fuzzer::run(int cases){
+    jit.start();
+    Outcome single;
+    Outcome block;
+    Outcome interpreterSingle;
+    Outcome interpreterBlock;
+    Outcome actual;
+    for(int i = 0; i < cases; ++i){
+        makeCase();
+        runReference(single, block);
+        runInterpreter(interpreterSingle, interpreterBlock);
+        uint8_t opcode = startMemory[startRegisters.pc];
+        for(int engine = 0; engine < ENGINE_COUNT; ++engine){
+            if(engine == JIT && !jit.enabled){
+                continue;
+            }
+            runs[engine][opcode]++;
+            if(engine == DECODER){
+                actual = interpreterSingle;
+            }
+            else{
+                int cycles = runEngine((Engine)engine);
+                readCpu(actual, cycles);
+                QString divergence = compare(actual, engine == HANDLERS ? interpreterSingle : interpreterBlock);
+                if(!divergence.isEmpty() && divergences[engine][opcode]++ == 0){
+                    firstDivergence[engine][opcode] = divergence + "\n        from " + describeCase();
+                }
+            }
+            QString difference = compare(actual, engine == DECODER || engine == HANDLERS ? single : block);
+            if(!difference.isEmpty() && mismatches[engine][opcode]++ == 0){
+                firstMismatch[engine][opcode] = difference + "\n        from " + describeCase();
+            }
+        }
+        cpu.blockCache.invalidate(startRegisters.pc);
+    }
+
+    QTextStream out(stdout);
+    int failedOpcodes[ENGINE_COUNT] = {0};
+    int divergedOpcodes[ENGINE_COUNT] = {0};
+    for(int opcode = 0; opcode < 256; ++opcode){
+        for(int engine = 0; engine < ENGINE_COUNT; ++engine){
+            if(mismatches[engine][opcode] == 0){
+                continue;
+            }
+            failedOpcodes[engine]++;
+            out << QString("0x%1 %2  %3 of %4 cases differ from the reference: %5\n")
+                   .arg(opcode, 2, 16, QChar('0'))
+                   .arg(ENGINE_NAMES[engine], -8)
+                   .arg(mismatches[engine][opcode])
+                   .arg(runs[engine][opcode])
+                   .arg(firstMismatch[engine][opcode]);
+        }
+    }
+    for(int opcode = 0; opcode < 256; ++opcode){
+        for(int engine = HANDLERS; engine < ENGINE_COUNT; ++engine){
+            if(divergences[engine][opcode] == 0){
+                continue;
+            }
+            divergedOpcodes[engine]++;
+            out << QString("0x%1 %2  %3 of %4 cases differ from the decoder: %5\n")
+                   .arg(opcode, 2, 16, QChar('0'))
+                   .arg(ENGINE_NAMES[engine], -8)
+                   .arg(divergences[engine][opcode])
+                   .arg(runs[engine][opcode])
+                   .arg(firstDivergence[engine][opcode]);
+        }
+    }
+
+    int total = 0;
+    out << QString("Fuzzed %1 cases against the reference 8080 and the decoder with seed %2\n")
+           .arg(cases).arg(seed);
+    for(int engine = 0; engine < ENGINE_COUNT; ++engine){
+        if(engine == JIT && !jit.enabled){
+            out << QString("  %1 not available on this host\n").arg(ENGINE_NAMES[engine], -8);
+            continue;
+        }
+        if(engine == DECODER){
+            out << QString("  %1 %2 opcodes differ from the reference\n")
+                   .arg(ENGINE_NAMES[engine], -8).arg(failedOpcodes[engine]);
+            continue;
+        }
+        out << QString("  %1 %2 opcodes differ from the decoder, %3 from the reference\n")
+               .arg(ENGINE_NAMES[engine], -8).arg(divergedOpcodes[engine]).arg(failedOpcodes[engine]);
+        total += divergedOpcodes[engine];
+    }
+    return total == 0 ? 0 : 1;
+}
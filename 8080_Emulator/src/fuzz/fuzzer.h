@@ -0,0 +1,88 @@
+/**************************************************************************************************
+    ** File Name: fuzzer.h
+    ** Description: This file contains the Class declaration for the Fuzzer class, a differential
+        fuzzer for the Cpu. Each case is a random set of registers, flags, memory and I/O with a
+        single instruction at the pc. The case is run by every engine the Cpu has (the getInstruction
+        decoder, the specialised handlers, the block cache and the Jit) and by the ReferenceCpu,
+        and any difference in registers, flags, memory, I/O or cycles is reported per opcode.
+        The handlers, block cache and Jit are also held to the decoder, the single-step
+        interpreter, and only those differences fail the run: the core has known differences
+        from the reference that would otherwise hide a regression in the faster engines.
+**************************************************************************************************/
+#include <QString>
+
+#include "../cpu/cpu.h"
+#include "../jit/jit.h"
+#include "referenceCpu.h"
+
+#ifndef FUZZER_H
+#define FUZZER_H
+
+const int FUZZ_MEMORY_REFRESH = 64;             //cases run before memory is randomised again
+
+class Fuzzer
+{
+public:
+    Fuzzer(uint32_t seed);                      //constructor
+    ~Fuzzer();                                  //destructor
+
+    int run(int cases);                         //returns 0 if every engine matched the decoder
+
+private:
+    enum Engine{ DECODER, HANDLERS, BLOCKS, JIT, ENGINE_COUNT };
+
+    //what an instruction left behind, in a form both the Cpu and the reference can fill in
+    struct Outcome{
+        uint16_t bc, de, hl, sp, pc;
+        uint8_t a, flags;
+        bool interrupts;
+        uint8_t outputs[7];                     //the latches on ports 3, 5 and 6
+        uint16_t shift;                         //the shift register's contents
+        uint8_t shiftAmount;                    //and the amount set on port 2
+        int cycles;
+        const uint8_t *memory;
+    };
+
+    uint32_t random();
+    void makeCase();
+    void loadCpu();
+    void readCpu(Outcome &outcome, int cycles);
+    void runReference(Outcome &single, Outcome &block);
+    void readReference(Outcome &outcome, int cycles);
+    void runInterpreter(Outcome &single, Outcome &block);
+    int runEngine(Engine engine);
+    QString compare(const Outcome &actual, const Outcome &expected);
+    QString describeCase();
+
+    uint32_t seed;
+    uint32_t state;                             //random number generator state
+    Cpu cpu;
+    Jit jit;
+    ReferenceCpu reference;
+
+    //the current case
+    Cpu::State8080Registers startRegisters;
+    uint8_t startFlags;
+    bool startInterrupts;
+    uint8_t startInputs[4];
+    uint8_t startOutputs[7];
+    uint16_t startShift;
+    uint8_t startShiftAmount;
+    uint8_t *startMemory;
+    uint8_t *singleMemory;                      //reference memory after the instruction
+    bool blockStops;                            //set if the block engines stop before the JMP
+    uint8_t *interpreterSingleMemory;           //decoder memory after the instruction
+    uint8_t *interpreterBlockMemory;            //and after the JMP as well, if it ran
+    int caseNumber;
+
+    //the first difference seen for each engine and opcode, and how often it happened
+    int mismatches[ENGINE_COUNT][256];
+    int runs[ENGINE_COUNT][256];
+    QString firstMismatch[ENGINE_COUNT][256];
+
+    //the same for the handlers, block cache and Jit held to the decoder
+    int divergences[ENGINE_COUNT][256];
+    QString firstDivergence[ENGINE_COUNT][256];
+};
+
+#endif // FUZZER_H
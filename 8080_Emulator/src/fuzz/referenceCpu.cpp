@@ -0,0 +1,435 @@
+/**************************************************************************************************
+    ** File Name: referenceCpu.cpp
+    ** Description: Contains the member function definitions for the ReferenceCpu class.
+**************************************************************************************************/
+#include <string.h>
+
+#include "referenceCpu.h"
+
+//flag register bits
+const uint8_t FLAG_SIGN = 0x80;
+const uint8_t FLAG_ZERO = 0x40;
+const uint8_t FLAG_AUX = 0x10;
+const uint8_t FLAG_PARITY = 0x04;
+const uint8_t FLAG_ALWAYS_SET = 0x02;
+const uint8_t FLAG_CARRY = 0x01;
+
+const int FIELD_M = 6;                          //register field naming memory at HL
+const int FIELD_SP_PSW = 3;                     //pair field naming SP, or PSW for PUSH and POP
+
+
+/**************************************************************************************************
+    ** Function Name: ReferenceCpu::ReferenceCpu()
+    ** Description: The default constructor for the ReferenceCpu class, allocates the address
+        space and clears every register.
+**************************************************************************************************/
+ReferenceCpu::ReferenceCpu()
+{
+    memory = new uint8_t[0x10000];
+    memset(memory, 0, 0x10000);
+    memset(inputs, 0, sizeof(inputs));
+    a = b = c = d = e = h = l = 0;
+    f = FLAG_ALWAYS_SET;
+    sp = pc = 0;
+    interrupts = false;
+    halted = false;
+    outPort = -1;
+    outValue = 0;
+    writeCount = 0;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: ReferenceCpu::~ReferenceCpu()
+    ** Description: Destructor for the ReferenceCpu class, frees the address space.
+**************************************************************************************************/
+ReferenceCpu::~ReferenceCpu(){
+    delete[] memory;
+}
+
+//reads a register by its 3 bit field, where 6 is memory at HL
+uint8_t ReferenceCpu::readRegister(int field){
+    switch(field){
+    case 0: return b;
+    case 1: return c;
+    case 2: return d;
+    case 3: return e;
+    case 4: return h;
+    case 5: return l;
+    case FIELD_M: return memory[(uint16_t)((h << 8) | l)];
+    default: return a;
+    }
+}
+
+//writes a register by its 3 bit field, where 6 is memory at HL
+void ReferenceCpu::writeRegister(int field, uint8_t value){
+    switch(field){
+    case 0: b = value; break;
+    case 1: c = value; break;
+    case 2: d = value; break;
+    case 3: e = value; break;
+    case 4: h = value; break;
+    case 5: l = value; break;
+    case FIELD_M: write((h << 8) | l, value); break;
+    default: a = value; break;
+    }
+}
+
+//reads a register pair by its 2 bit field, where 3 is SP
+uint16_t ReferenceCpu::readPair(int field){
+    switch(field){
+    case 0: return (b << 8) | c;
+    case 1: return (d << 8) | e;
+    case 2: return (h << 8) | l;
+    default: return sp;
+    }
+}
+
+//writes a register pair by its 2 bit field, where 3 is SP
+void ReferenceCpu::writePair(int field, uint16_t value){
+    switch(field){
+    case 0: b = value >> 8; c = value; break;
+    case 1: d = value >> 8; e = value; break;
+    case 2: h = value >> 8; l = value; break;
+    default: sp = value; break;
+    }
+}
+
+//checks a branch condition by its 3 bit field: NZ, Z, NC, C, PO, PE, P, M
+bool ReferenceCpu::condition(int field){
+    static const uint8_t FLAG_OF_CONDITION[4] = {FLAG_ZERO, FLAG_CARRY, FLAG_PARITY, FLAG_SIGN};
+    bool set = (f & FLAG_OF_CONDITION[field >> 1]) != 0;
+    return (field & 1) ? set : !set;
+}
+
+//stores a byte and remembers where, so callers can tell which addresses an instruction wrote
+void ReferenceCpu::write(uint16_t address, uint8_t value){
+    memory[address] = value;
+    if(writeCount < 2){
+        writes[writeCount] = address;
+    }
+    writeCount++;
+}
+
+//reads a little endian word, wrapping at the top of memory
+uint16_t ReferenceCpu::read16(uint16_t address){
+    return memory[address] | (memory[(uint16_t)(address + 1)] << 8);
+}
+
+void ReferenceCpu::push16(uint16_t value){
+    sp -= 2;
+    write(sp, value);
+    write(sp + 1, value >> 8);
+}
+
+uint16_t ReferenceCpu::pop16(){
+    uint16_t value = read16(sp);
+    sp += 2;
+    return value;
+}
+
+void ReferenceCpu::setZeroSignParity(uint8_t value){
+    uint8_t ones = value;
+    ones ^= ones >> 4;
+    ones ^= ones >> 2;
+    ones ^= ones >> 1;
+    f &= ~(FLAG_ZERO | FLAG_SIGN | FLAG_PARITY);
+    f |= value & FLAG_SIGN;
+    f |= value == 0 ? FLAG_ZERO : 0;
+    f |= (ones & 1) ? 0 : FLAG_PARITY;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void ReferenceCpu::arithmetic(int operation, uint8_t value)
+    ** Description: Applies one of the eight accumulator operations, ADD ADC SUB SBB ANA XRA ORA
+        CMP in field order, to a and value. Subtraction is done as addition of the complement
+        with the carry inverted, which is how the 8080 gets its auxiliary carry for SUB and CMP.
+        ANA sets the auxiliary carry from bit 3 of either operand, XRA and ORA clear it.
+**************************************************************************************************/
+void ReferenceCpu::arithmetic(int operation, uint8_t value){
+    uint8_t carry = f & FLAG_CARRY;
+    uint8_t result;
+    switch(operation){
+    case 0:                                     //ADD
+    case 1:                                     //ADC
+    case 2:                                     //SUB
+    case 3:                                     //SBB
+    case 7:                                     //CMP
+    {
+        bool subtract = operation == 2 || operation == 3 || operation == 7;
+        uint8_t carryIn = (operation == 1 || operation == 3) ? carry : 0;
+        uint8_t operand = subtract ? ~value : value;
+        if(subtract){
+            carryIn ^= 1;
+        }
+        unsigned sum = a + operand + carryIn;
+        bool aux = ((a & 0x0F) + (operand & 0x0F) + carryIn) > 0x0F;
+        bool carryOut = (sum > 0xFF) != subtract;
+        result = sum;
+        f = (f & ~(FLAG_AUX | FLAG_CARRY)) | (aux ? FLAG_AUX : 0) | (carryOut ? FLAG_CARRY : 0);
+        setZeroSignParity(result);
+        if(operation != 7){
+            a = result;
+        }
+        return;
+    }
+    case 4:                                     //ANA
+        result = a & value;
+        f = (f & ~(FLAG_AUX | FLAG_CARRY)) | (((a | value) & 0x08) ? FLAG_AUX : 0);
+        break;
+    case 5:                                     //XRA
+        result = a ^ value;
+        f &= ~(FLAG_AUX | FLAG_CARRY);
+        break;
+    default:                                    //ORA
+        result = a | value;
+        f &= ~(FLAG_AUX | FLAG_CARRY);
+        break;
+    }
+    a = result;
+    setZeroSignParity(result);
+}
+
+//INR, the carry is left alone
+uint8_t ReferenceCpu::increment(uint8_t value){
+    uint8_t result = value + 1;
+    f = (f & ~FLAG_AUX) | ((result & 0x0F) == 0 ? FLAG_AUX : 0);
+    setZeroSignParity(result);
+    return result;
+}
+
+//DCR, the carry is left alone
+uint8_t ReferenceCpu::decrement(uint8_t value){
+    uint8_t result = value - 1;
+    f = (f & ~FLAG_AUX) | ((result & 0x0F) != 0x0F ? FLAG_AUX : 0);
+    setZeroSignParity(result);
+    return result;
+}
+
+//DAA, corrects a after adding two packed BCD numbers
+void ReferenceCpu::decimalAdjust(){
+    uint8_t correction = 0;
+    bool carry = (f & FLAG_CARRY) != 0;
+    if((a & 0x0F) > 9 || (f & FLAG_AUX)){
+        correction |= 0x06;
+    }
+    if(a > 0x99 || carry){
+        correction |= 0x60;
+        carry = true;
+    }
+    bool aux = ((a & 0x0F) + (correction & 0x0F)) > 0x0F;
+    a += correction;
+    f = (f & ~(FLAG_AUX | FLAG_CARRY)) | (aux ? FLAG_AUX : 0) | (carry ? FLAG_CARRY : 0);
+    setZeroSignParity(a);
+}
+
+
+/**************************************************************************************************
+    ** Function Name: int ReferenceCpu::step()
+    ** Description: Runs the instruction at pc and returns the number of cycles it takes on an
+        8080, including the M operand forms and the taken and untaken costs of conditional calls
+        and returns. The undocumented opcodes run as the instructions they alias. HLT sets halted
+        and leaves pc on the next instruction.
+**************************************************************************************************/
+int ReferenceCpu::step(){
+    writeCount = 0;
+    uint8_t opcode = memory[pc];
+    uint16_t immediate = read16((uint16_t)(pc + 1));
+    uint8_t byte = immediate;
+    int destination = (opcode >> 3) & 7;
+    int source = opcode & 7;
+    int pair = (opcode >> 4) & 3;
+
+    //MOV and HLT
+    if((opcode & 0xC0) == 0x40){
+        pc++;
+        if(opcode == 0x76){
+            halted = true;
+            return 7;
+        }
+        writeRegister(destination, readRegister(source));
+        return (destination == FIELD_M || source == FIELD_M) ? 7 : 5;
+    }
+
+    //register and memory forms of the accumulator operations
+    if((opcode & 0xC0) == 0x80){
+        pc++;
+        arithmetic(destination, readRegister(source));
+        return source == FIELD_M ? 7 : 4;
+    }
+
+    if((opcode & 0xC0) == 0x00){
+        switch(source){
+        case 0:                                 //NOP and its aliases
+            pc++;
+            return 4;
+        case 1:
+            if(opcode & 0x08){                  //DAD
+                unsigned sum = readPair(2) + readPair(pair);
+                writePair(2, sum);
+                f = (f & ~FLAG_CARRY) | (sum > 0xFFFF ? FLAG_CARRY : 0);
+                pc++;
+                return 10;
+            }
+            writePair(pair, immediate);         //LXI
+            pc += 3;
+            return 10;
+        case 2:
+            switch(opcode){
+            case 0x02: write(readPair(0), a); pc++; return 7;           //STAX B
+            case 0x12: write(readPair(1), a); pc++; return 7;           //STAX D
+            case 0x0A: a = memory[readPair(0)]; pc++; return 7;        //LDAX B
+            case 0x1A: a = memory[readPair(1)]; pc++; return 7;        //LDAX D
+            case 0x22:                                                 //SHLD
+                write(immediate, l);
+                write(immediate + 1, h);
+                pc += 3;
+                return 16;
+            case 0x2A:                                                 //LHLD
+                writePair(2, read16(immediate));
+                pc += 3;
+                return 16;
+            case 0x32: write(immediate, a); pc += 3; return 13;         //STA
+            default: a = memory[immediate]; pc += 3; return 13;        //LDA
+            }
+        case 3:                                 //INX and DCX
+            writePair(pair, readPair(pair) + ((opcode & 0x08) ? -1 : 1));
+            pc++;
+            return 5;
+        case 4:                                 //INR
+            writeRegister(destination, increment(readRegister(destination)));
+            pc++;
+            return destination == FIELD_M ? 10 : 5;
+        case 5:                                 //DCR
+            writeRegister(destination, decrement(readRegister(destination)));
+            pc++;
+            return destination == FIELD_M ? 10 : 5;
+        case 6:                                 //MVI
+            writeRegister(destination, byte);
+            pc += 2;
+            return destination == FIELD_M ? 10 : 7;
+        default:
+            switch(destination){
+            case 0:                             //RLC
+                f = (f & ~FLAG_CARRY) | (a >> 7);
+                a = (a << 1) | (a >> 7);
+                break;
+            case 1:                             //RRC
+                f = (f & ~FLAG_CARRY) | (a & 1);
+                a = (a >> 1) | (a << 7);
+                break;
+            case 2:                             //RAL
+            {
+                uint8_t carry = f & FLAG_CARRY;
+                f = (f & ~FLAG_CARRY) | (a >> 7);
+                a = (a << 1) | carry;
+                break;
+            }
+            case 3:                             //RAR
+            {
+                uint8_t carry = f & FLAG_CARRY;
+                f = (f & ~FLAG_CARRY) | (a & 1);
+                a = (a >> 1) | (carry << 7);
+                break;
+            }
+            case 4: decimalAdjust(); break;     //DAA
+            case 5: a = ~a; break;              //CMA
+            case 6: f |= FLAG_CARRY; break;     //STC
+            default: f ^= FLAG_CARRY; break;    //CMC
+            }
+            pc++;
+            return 4;
+        }
+    }
+
+    //0xC0 to 0xFF
+    switch(source){
+    case 0:                                     //conditional returns
+        if(condition(destination)){
+            pc = pop16();
+            return 11;
+        }
+        pc++;
+        return 5;
+    case 1:
+        if(!(opcode & 0x08)){                   //POP
+            uint16_t value = pop16();
+            if(pair == FIELD_SP_PSW){
+                a = value >> 8;
+                f = (value & (FLAG_SIGN | FLAG_ZERO | FLAG_AUX | FLAG_PARITY | FLAG_CARRY)) | FLAG_ALWAYS_SET;
+            }
+            else{
+                writePair(pair, value);
+            }
+            pc++;
+            return 10;
+        }
+        switch(opcode){
+        case 0xE9: pc = readPair(2); return 5;                         //PCHL
+        case 0xF9: sp = readPair(2); pc++; return 5;                   //SPHL
+        default: pc = pop16(); return 10;                              //RET and its alias
+        }
+    case 2:                                     //conditional jumps
+        pc = condition(destination) ? immediate : (uint16_t)(pc + 3);
+        return 10;
+    case 3:
+        switch(opcode){
+        case 0xD3:                                                     //OUT
+            outPort = byte;
+            outValue = a;
+            pc += 2;
+            return 10;
+        case 0xDB:                                                     //IN
+            a = inputs[byte];
+            pc += 2;
+            return 10;
+        case 0xE3:                                                     //XTHL
+        {
+            uint16_t top = read16(sp);
+            write(sp, l);
+            write(sp + 1, h);
+            writePair(2, top);
+            pc++;
+            return 18;
+        }
+        case 0xEB:                                                     //XCHG
+        {
+            uint16_t hl = readPair(2);
+            writePair(2, readPair(1));
+            writePair(1, hl);
+            pc++;
+            return 4;
+        }
+        case 0xF3: interrupts = false; pc++; return 4;                 //DI
+        case 0xFB: interrupts = true; pc++; return 4;                  //EI
+        default: pc = immediate; return 10;                            //JMP and its alias
+        }
+    case 4:                                     //conditional calls
+        if(condition(destination)){
+            push16(pc + 3);
+            pc = immediate;
+            return 17;
+        }
+        pc += 3;
+        return 11;
+    case 5:
+        if(!(opcode & 0x08)){                   //PUSH
+            uint16_t value = pair == FIELD_SP_PSW ? (a << 8) | f : readPair(pair);
+            push16(value);
+            pc++;
+            return 11;
+        }
+        push16(pc + 3);                         //CALL and its aliases
+        pc = immediate;
+        return 17;
+    case 6:                                     //immediate forms of the accumulator operations
+        arithmetic(destination, byte);
+        pc += 2;
+        return 7;
+    default:                                    //RST
+        push16(pc + 1);
+        pc = destination << 3;
+        return 11;
+    }
+}
@@ -0,0 +1,54 @@
+/**************************************************************************************************
+    ** File Name: referenceCpu.h
+    ** Description: This file contains the Class declaration for the ReferenceCpu class, a plain
+        model of the Intel 8080 written from the data sheet and kept separate from the Cpu class
+        on purpose. It decodes each opcode from its bit fields, keeps the flags as a single byte
+        and charges the documented cycles, with no caching or specialisation, so the Fuzzer can
+        hold the faster engines up against it. Only the processor is modelled: IN reads from the
+        inputs table and OUT is recorded for the caller to act on.
+**************************************************************************************************/
+#include <stdint.h>
+
+#ifndef REFERENCECPU_H
+#define REFERENCECPU_H
+
+class ReferenceCpu
+{
+public:
+    ReferenceCpu();                             //default constructor
+    ~ReferenceCpu();                            //destructor
+
+    int step();                                 //runs the instruction at pc, returns its cycles
+
+    uint8_t a, b, c, d, e, h, l;
+    uint8_t f;                                  //flag register, laid out as PUSH PSW stores it
+    uint16_t sp, pc;
+    bool interrupts;
+    bool halted;
+
+    uint8_t *memory;                            //the full 64K address space
+    uint8_t inputs[256];                        //value IN reads from each port
+    int outPort;                                //port of the last OUT, -1 if there was none
+    uint8_t outValue;
+    uint16_t writes[2];                         //addresses written by the last instruction
+    int writeCount;
+
+private:
+    uint8_t readRegister(int field);
+    void writeRegister(int field, uint8_t value);
+    uint16_t readPair(int field);
+    void writePair(int field, uint16_t value);
+    bool condition(int field);
+    void write(uint16_t address, uint8_t value);
+    uint16_t read16(uint16_t address);
+    void push16(uint16_t value);
+    uint16_t pop16();
+
+    void setZeroSignParity(uint8_t value);
+    void arithmetic(int operation, uint8_t value);
+    uint8_t increment(uint8_t value);
+    uint8_t decrement(uint8_t value);
+    void decimalAdjust();
+};
+
+#endif // REFERENCECPU_H
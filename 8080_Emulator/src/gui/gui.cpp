@@ -13,13 +13,15 @@ Gui::Gui()
     this->setWindowTitle(QString("Space Invaders"));
     layout->addWidget(screen);
     //connects the emulator signal to the gui slot and input received signal to the handler slot
-    connect(&emulator, SIGNAL(screenIsUpdated(const QImage*)), this, SLOT(showScreen(const QImage*)));
+    connect(&emulator, SIGNAL(screenIsUpdated(const QImage*,quint64)), this,
+            SLOT(showScreen(const QImage*,quint64)));
     connect(this, SIGNAL(inputReceived(int,bool)), &emulator, SLOT(inputHandler(int,bool)));
 }
 
-//sets the pixelmap for painting the screen
-void Gui::showScreen(const QImage* image){
+//sets the pixelmap for painting the screen, then tells the latency monitor the frame is up
+void Gui::showScreen(const QImage* image, quint64 frame){
     screen->setPixmap(QPixmap::fromImage(*image));
+    emulator.latency.framePresented(frame);
 }
 
 //emits the input received signal for when the control keys are pressed
@@ -36,8 +38,10 @@ void Gui::runEmulator(){
     emulator.start();       //run the emulator
 }
 
-//destructor that terminates qThread process
+//destructor that stops the qThread process, the emulator leaves its loop at the next half frame
+//so it never stops while holding a lock or part way through a write
 Gui::~Gui(){
-    emulator.terminate();
+    emulator.requestInterruption();
     emulator.wait();
+    emulator.finish();      //the thread is stopped so its results can be saved safely
 }
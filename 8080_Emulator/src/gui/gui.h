@@ -27,7 +27,7 @@ private:
     Emulator emulator;
 
 public slots:
-    void showScreen(QImage const*);         //catches the screen updated signal from Emulator
+    void showScreen(QImage const*, quint64 frame);  //catches the screen updated signal from Emulator
 
 protected:
     void keyPressEvent(QKeyEvent *);        //catches the QKey event for key presses
@@ -0,0 +1,37 @@
+/**************************************************************************************************
+    ** File Name: ioBus.cpp
+    ** Description: Contains the member function definitions for the IoBus class.
+**************************************************************************************************/
+#include <string.h>
+
+#include "ioBus.h"
+
+
+//constructor, every port starts with nothing on it
+IoBus::IoBus()
+{
+    clear();
+}
+
+//detaches every port
+void IoBus::clear(){
+    memset(inputs, 0, sizeof(inputs));
+    memset(outputs, 0, sizeof(outputs));
+}
+
+//wires reads of port to device's register reg, ports outside 0 to 255, such as the -1 a
+//PortMap uses for a port the board does not have, are ignored
+void IoBus::attachInput(int port, IoDevice *device, int reg){
+    if(port >= 0 && port < 256){
+        inputs[port].device = device;
+        inputs[port].reg = reg;
+    }
+}
+
+//wires writes to port to device's register reg, ports outside 0 to 255 are ignored
+void IoBus::attachOutput(int port, IoDevice *device, int reg){
+    if(port >= 0 && port < 256){
+        outputs[port].device = device;
+        outputs[port].reg = reg;
+    }
+}
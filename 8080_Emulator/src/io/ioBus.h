@@ -0,0 +1,59 @@
+/**************************************************************************************************
+    ** File Name: ioBus.h
+    ** Description: This file contains the Class declarations for the IoDevice and IoBus classes.
+        The IoBus stands in for a board's port decoding: each of the 256 input and output ports
+        is wired to a register of one IoDevice, or to nothing. The Cpu's in and out go through
+        it, so a board's hardware, such as the ShiftRegister, is a device attached to the ports
+        its Machine description gives instead of a case in the Cpu.
+**************************************************************************************************/
+#include <stdint.h>
+
+#ifndef IOBUS_H
+#define IOBUS_H
+
+
+//hardware reached through the I/O ports, its registers are numbered by the device itself
+class IoDevice
+{
+public:
+    virtual ~IoDevice(){}
+    virtual uint8_t read(int reg) = 0;
+    virtual void write(int reg, uint8_t value) = 0;
+};
+
+class IoBus
+{
+public:
+    IoBus();                                    //constructor, with nothing attached
+    void clear();                               //detaches every port
+    void attachInput(int port, IoDevice *device, int reg);
+    void attachOutput(int port, IoDevice *device, int reg);
+
+    //reads port into value, leaving value alone and returning false if nothing is on it
+    bool read(uint8_t port, uint8_t &value){
+        const Connection &connection = inputs[port];
+        if(connection.device == nullptr){
+            return false;
+        }
+        value = connection.device->read(connection.reg);
+        return true;
+    }
+
+    //writes value to port, writes to ports with nothing on them are lost
+    void write(uint8_t port, uint8_t value){
+        const Connection &connection = outputs[port];
+        if(connection.device != nullptr){
+            connection.device->write(connection.reg, value);
+        }
+    }
+
+private:
+    struct Connection{
+        IoDevice *device;
+        int reg;
+    };
+    Connection inputs[256];
+    Connection outputs[256];
+};
+
+#endif // IOBUS_H
@@ -0,0 +1,28 @@
+/**************************************************************************************************
+    ** File Name: shiftRegister.cpp
+    ** Description: Contains the member function definitions for the ShiftRegister class.
+**************************************************************************************************/
+#include "shiftRegister.h"
+
+
+//constructor, the register powers up empty
+ShiftRegister::ShiftRegister()
+{
+    contents = 0;
+    amount = 0;
+}
+
+//the result is the only register that can be read
+uint8_t ShiftRegister::read(int){
+    return result();
+}
+
+//latches the shift amount, or pushes a data byte in from the top
+void ShiftRegister::write(int reg, uint8_t value){
+    if(reg == AMOUNT){
+        amount = value & 7;
+    }
+    else if(reg == DATA){
+        contents = (value << 8) | (contents >> 8);
+    }
+}
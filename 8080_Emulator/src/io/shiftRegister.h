@@ -0,0 +1,39 @@
+/**************************************************************************************************
+    ** File Name: shiftRegister.h
+    ** Description: This file contains the Class declaration for the ShiftRegister class, the
+        Fujitsu MB14241 the Midway and Taito boards use to shift sprites into place, as the 8080
+        has no barrel shifter. Each byte written to the data port pushes the one before it into
+        the low half of a 16 bit register, and reading the result port gives the 8 bits that
+        start amount bits below the top, so drawing a sprite at any x is a write of each byte
+        followed by a read.
+**************************************************************************************************/
+#include "ioBus.h"
+
+#ifndef SHIFTREGISTER_H
+#define SHIFTREGISTER_H
+
+
+class ShiftRegister : public IoDevice
+{
+public:
+    //the device's registers, as attached to the ports by Cpu::setPorts
+    enum Register{
+        AMOUNT,                                 //written with the shift amount, port 2 on invaders
+        DATA,                                   //written with each byte to shift, port 4
+        RESULT                                  //read for the shifted byte, port 3
+    };
+
+    ShiftRegister();                            //constructor
+    uint8_t read(int reg);                      //reads the result
+    void write(int reg, uint8_t value);         //sets the amount or shifts in a byte
+
+    //the byte the result port reads
+    uint8_t result() const{
+        return (uint8_t)(contents >> (8 - amount));
+    }
+
+    uint16_t contents;                          //last byte written in the high half, the one before in the low
+    uint8_t amount;                             //0 to 7, only the low 3 bits of a write are kept
+};
+
+#endif // SHIFTREGISTER_H
@@ -0,0 +1,628 @@
+/**************************************************************************************************
+    ** File Name: jit.cpp
+    ** Description: Contains the member function definitions for the Jit class.
+**************************************************************************************************/
+#include <QDebug>
+#include <stddef.h>
+
+#include "jit.h"
+
+#ifdef JIT_SUPPORTED
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <sys/mman.h>
+#include <cpuid.h>
+#endif
+#endif
+
+/*NOTES:
+        - While a native block runs the 8080 registers live in x86 registers:
+            A = al, B = ch, C = cl, D = dh, E = dl, H = bh, L = bl, SP = bp
+        so the pairs BC, DE and HL are simply cx, dx and bx. ah is scratch space for LAHF/SAHF,
+        rsi points at the JitState, rdi at the 8080 memory, r10 at the code page counts and r11
+        is scratch. None of these instructions may carry a REX prefix when they name ah-bh.
+
+        - The flag byte stays in the JitState. x86 keeps S, Z, AC, P and CY at the same bit
+        positions as the 8080, so LAHF gives flags that can be merged straight into it.
+
+        - Every store first checks the code page counts and leaves the block before writing if
+        the page holds cached code, so the interpreter does the store and drops stale blocks.
+*/
+
+//x86 register number holding each 8080 register, indexed by the 3 bit field in the opcode
+static const uint8_t X86_REGISTERS[8] = {5, 1, 6, 2, 7, 3, 0xFF, 0};
+//x86 register number of the 16 bit register holding each register pair (BC, DE, HL, SP)
+static const uint8_t X86_PAIRS[4] = {1, 2, 3, 5};
+const uint8_t M_REGISTER = 6;
+
+//byte offsets of the JitState members used by the generated code
+const uint8_t STATE_A = 6;
+const uint8_t STATE_F = 7;
+const uint8_t STATE_PC = 10;
+const uint8_t STATE_CYCLES = 12;
+
+
+//checks that LAHF and SAHF can be used in 64 bit mode, early x86-64 chips left them out
+static bool hostSupportsLahf(){
+#if defined(JIT_SUPPORTED) && defined(_WIN32)
+    int info[4];
+    __cpuid(info, 0x80000001);
+    return (info[2] & 1) != 0;
+#elif defined(JIT_SUPPORTED)
+    unsigned int eax, ebx, ecx, edx;
+    if(!__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx)){
+        return false;
+    }
+    return (ecx & 1) != 0;
+#else
+    return false;
+#endif
+}
+
+
+/**************************************************************************************************
+    ** Function Name: Jit::Jit(Cpu *cpu)
+    ** Description: Constructor for the Jit class. No executable memory is taken until start is
+        called, so an emulator that never turns the Jit on pays nothing for it.
+**************************************************************************************************/
+Jit::Jit(Cpu *cpu)
+{
+    this->cpu = cpu;
+    buffer = nullptr;
+    bufferUsed = 0;
+    shadowMemory = nullptr;
+    enabled = false;
+    verify = false;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: Jit::~Jit()
+    ** Description: Destructor for the Jit class, releases the executable memory.
+**************************************************************************************************/
+Jit::~Jit(){
+#ifdef JIT_SUPPORTED
+    if(buffer != nullptr){
+#ifdef _WIN32
+        VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+        munmap(buffer, JIT_BUFFER_SIZE);
+#endif
+    }
+#endif
+    delete[] shadowMemory;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool Jit::start()
+    ** Description: Maps the buffer native code is written into. The buffer is never writable and
+        executable at the same time; if the host refuses either mapping the Jit stays off and the
+        emulator keeps interpreting.
+**************************************************************************************************/
+bool Jit::start(){
+#ifdef JIT_SUPPORTED
+#ifdef CPU_PROFILING
+    qWarning("Jit: native blocks cannot be profiled, using the interpreter");
+    return false;
+#endif
+    if(!hostSupportsLahf()){
+        qWarning("Jit: LAHF/SAHF are not available in 64 bit mode, using the interpreter");
+        return false;
+    }
+#ifdef _WIN32
+    buffer = (uint8_t*)VirtualAlloc(nullptr, JIT_BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void *mapping = mmap(nullptr, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffer = mapping == MAP_FAILED ? nullptr : (uint8_t*)mapping;
+#endif
+    if(buffer == nullptr || !makeExecutable()){
+        qWarning("Jit: could not map executable memory, using the interpreter");
+        return false;
+    }
+    if(verify){
+        shadowMemory = new uint8_t[0x10000];
+    }
+    enabled = true;
+    return true;
+#else
+    qWarning("Jit: native code is only generated on x86-64, using the interpreter");
+    return false;
+#endif
+}
+
+//flips the code buffer to read/write so a block can be written into it
+bool Jit::makeWritable(){
+#if defined(JIT_SUPPORTED) && defined(_WIN32)
+    DWORD oldProtection;
+    return VirtualProtect(buffer, JIT_BUFFER_SIZE, PAGE_READWRITE, &oldProtection) != 0;
+#elif defined(JIT_SUPPORTED)
+    return mprotect(buffer, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE) == 0;
+#else
+    return false;
+#endif
+}
+
+//flips the code buffer back to read/execute once a block has been written
+bool Jit::makeExecutable(){
+#if defined(JIT_SUPPORTED) && defined(_WIN32)
+    DWORD oldProtection;
+    if(VirtualProtect(buffer, JIT_BUFFER_SIZE, PAGE_EXECUTE_READ, &oldProtection) == 0){
+        return false;
+    }
+    return FlushInstructionCache(GetCurrentProcess(), buffer, JIT_BUFFER_SIZE) != 0;
+#elif defined(JIT_SUPPORTED)
+    return mprotect(buffer, JIT_BUFFER_SIZE, PROT_READ | PROT_EXEC) == 0;
+#else
+    return false;
+#endif
+}
+
+
+/**************************************************************************************************
+    ** Function Name: int Jit::run()
+    ** Description: Runs the block at the pc and returns the cycles it took. Blocks are counted
+        each time they are entered and translated once they reach HOT_BLOCK_THRESHOLD; until then,
+        or if they cannot be translated, the Cpu interprets them.
+**************************************************************************************************/
+int Jit::run(){
+    BlockCache::Block *block = cpu->blockCache.lookup(cpu->registers.pc);
+    if(block == nullptr){
+        block = cpu->blockCache.build(cpu->memory, cpu->registers.pc);
+    }
+
+    if(block->nativeCode == nullptr){
+        if(block->nativeTried || ++block->executions < HOT_BLOCK_THRESHOLD){
+            return cpu->runBlock(block);
+        }
+        compile(block);
+        if(block->nativeCode == nullptr){
+            return cpu->runBlock(block);
+        }
+    }
+
+    int cycles = verify ? runVerified(block) : runNative(block);
+    //native code leaves before a store to a page holding code, when that store is the block's
+    //first instruction nothing has run and the interpreter has to take the block instead
+    if(cycles == 0){
+        return cpu->runBlock(block);
+    }
+    return cycles;
+}
+
+//copies the Cpu's registers and flags into a JitState for native code to run on
+void Jit::loadState(JitState &state, uint8_t *memory){
+    state.a = cpu->registers.a;
+    state.b = cpu->registers.b;
+    state.c = cpu->registers.c;
+    state.d = cpu->registers.d;
+    state.e = cpu->registers.e;
+    state.h = cpu->registers.h;
+    state.l = cpu->registers.l;
+    state.f = cpu->flags.getRegisterValue();
+    state.sp = cpu->registers.sp;
+    state.pc = cpu->registers.pc;
+    state.cycles = 0;
+    state.memory = memory;
+    state.codePages = cpu->blockCache.codePageCounts();
+}
+
+//copies the registers and flags left by native code back into the Cpu
+void Jit::storeState(const JitState &state){
+    cpu->registers.a = state.a;
+    cpu->registers.b = state.b;
+    cpu->registers.c = state.c;
+    cpu->registers.d = state.d;
+    cpu->registers.e = state.e;
+    cpu->registers.h = state.h;
+    cpu->registers.l = state.l;
+    cpu->flags = Flags(state.f);
+    cpu->registers.sp = state.sp;
+    cpu->registers.pc = state.pc;
+}
+
+//runs a translated block on the Cpu's own memory
+int Jit::runNative(BlockCache::Block *block){
+    JitState state;
+    loadState(state, cpu->memory);
+    ((NativeBlock)block->nativeCode)(&state);
+    storeState(state);
+    return state.cycles;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: int Jit::runVerified(BlockCache::Block *block)
+    ** Description: Lockstep check of a translated block. The native code runs on a copy of
+        memory, then the interpreter runs the same instructions on the real Cpu and the two
+        results are compared. The interpreter's result is always the one kept, and the first
+        mismatch is reported and turns the Jit off.
+**************************************************************************************************/
+int Jit::runVerified(BlockCache::Block *block){
+    memcpy(shadowMemory, cpu->memory, 0x10000);
+    JitState state;
+    loadState(state, shadowMemory);
+    uint16_t startPc = state.pc;
+    ((NativeBlock)block->nativeCode)(&state);
+
+    //every instruction takes at least 4 cycles, so matching cycles means matching instructions
+    int cycles = 0;
+    while(cycles < (int)state.cycles){
+        cycles += cpu->emulateInstruction();
+    }
+
+    JitState expected;
+    loadState(expected, cpu->memory);
+    bool registersMatch = state.a == expected.a && state.b == expected.b && state.c == expected.c &&
+                          state.d == expected.d && state.e == expected.e && state.h == expected.h &&
+                          state.l == expected.l && state.f == expected.f && state.sp == expected.sp &&
+                          state.pc == expected.pc && (int)state.cycles == cycles;
+    if(!registersMatch || memcmp(shadowMemory, cpu->memory, 0x10000) != 0){
+        qWarning("Jit: block at %04X does not match the interpreter, turning the Jit off", startPc);
+        qWarning("  native:      A=%02X BC=%02X%02X DE=%02X%02X HL=%02X%02X F=%02X SP=%04X PC=%04X cycles=%u",
+                 state.a, state.b, state.c, state.d, state.e, state.h, state.l, state.f, state.sp,
+                 state.pc, state.cycles);
+        qWarning("  interpreter: A=%02X BC=%02X%02X DE=%02X%02X HL=%02X%02X F=%02X SP=%04X PC=%04X cycles=%d",
+                 expected.a, expected.b, expected.c, expected.d, expected.e, expected.h, expected.l,
+                 expected.f, expected.sp, expected.pc, cycles);
+        enabled = false;
+    }
+    return cycles;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Jit::compile(BlockCache::Block *block)
+    ** Description: Translates as much of the block as the code generator supports, starting at
+        its first instruction. Translation stops at the first unsupported instruction and the
+        native code exits there, so the interpreter carries on from that point. A block whose
+        first instruction is unsupported gets no native code at all.
+**************************************************************************************************/
+void Jit::compile(BlockCache::Block *block){
+    if(bufferUsed + JIT_MAX_BLOCK_SIZE > JIT_BUFFER_SIZE){
+        //out of room, throw every translation away and start over
+        cpu->blockCache.dropNativeCode();
+        bufferUsed = 0;
+    }
+    block->nativeTried = true;
+    if(!makeWritable()){
+        qWarning("Jit: could not make the code buffer writable, using the interpreter");
+        enabled = false;
+        return;
+    }
+
+    int start = bufferUsed;
+    emitPrologue();
+
+    uint16_t pc = block->start;
+    uint32_t cycles = 0;
+    int translated = 0;
+    bool closed = false;
+    for(int i = 0; i < block->opCount; ++i){
+        const BlockCache::DecodedOp &op = block->ops[i];
+        if(!emitOp(op, pc, cycles)){
+            break;
+        }
+        translated++;
+        cycles = op.cycleSum;
+        pc += op.length;
+        if(BlockCache::endsBlock(op.opcode)){
+            closed = true;
+            break;
+        }
+    }
+    if(!closed){
+        emitExit(pc, cycles);
+    }
+
+    if(translated == 0){
+        bufferUsed = start;
+    }
+    if(!makeExecutable()){
+        qWarning("Jit: could not make the code buffer executable, using the interpreter");
+        enabled = false;
+        return;
+    }
+    if(translated > 0){
+        block->nativeCode = buffer + start;
+    }
+}
+
+void Jit::put(uint8_t byte){
+    buffer[bufferUsed++] = byte;
+}
+
+void Jit::put16(uint16_t value){
+    put(value & 0xFF);
+    put(value >> 8);
+}
+
+void Jit::put32(uint32_t value){
+    put16(value & 0xFFFF);
+    put16(value >> 16);
+}
+
+//saves the callee saved registers used by native code and loads the 8080 state into them
+void Jit::emitPrologue(){
+    static_assert(offsetof(JitState, f) == STATE_F && offsetof(JitState, pc) == STATE_PC &&
+                  offsetof(JitState, cycles) == STATE_CYCLES && offsetof(JitState, memory) == 16 &&
+                  offsetof(JitState, codePages) == 24, "JitState layout is baked into the native code");
+    put(0x53);                                             //push rbx
+    put(0x55);                                             //push rbp
+    put(0x56);                                             //push rsi
+    put(0x57);                                             //push rdi
+#ifdef _WIN32
+    put(0x48); put(0x89); put(0xCE);                     //mov rsi, rcx
+#else
+    put(0x48); put(0x89); put(0xFE);                     //mov rsi, rdi
+#endif
+    put(0x48); put(0x8B); put(0x7E); put(16);           //mov rdi, [rsi+memory]
+    put(0x4C); put(0x8B); put(0x56); put(24);           //mov r10, [rsi+codePages]
+    put(0x0F); put(0xB7); put(0x0E);                     //movzx ecx, word [rsi+c]
+    put(0x0F); put(0xB7); put(0x56); put(2);            //movzx edx, word [rsi+e]
+    put(0x0F); put(0xB7); put(0x5E); put(4);            //movzx ebx, word [rsi+l]
+    put(0x0F); put(0xB6); put(0x46); put(STATE_A);      //movzx eax, byte [rsi+a]
+    put(0x0F); put(0xB7); put(0x6E); put(8);            //movzx ebp, word [rsi+sp]
+}
+
+//leaves the block with a fixed pc
+void Jit::emitExit(uint16_t pc, uint32_t cycles){
+    put(0x66); put(0xC7); put(0x46); put(STATE_PC);     //mov word [rsi+pc], imm16
+    put16(pc);
+    emitExitTail(cycles);
+}
+
+//leaves the block with the pc taken from HL, used by PCHL
+void Jit::emitExitToHL(uint32_t cycles){
+    put(0x66); put(0x89); put(0x5E); put(STATE_PC);     //mov [rsi+pc], bx
+    emitExitTail(cycles);
+}
+
+//stores the cycle count and registers back into the JitState and returns
+void Jit::emitExitTail(uint32_t cycles){
+    put(0xC7); put(0x46); put(STATE_CYCLES);             //mov dword [rsi+cycles], imm32
+    put32(cycles);
+    put(0x66); put(0x89); put(0x0E);                     //mov [rsi+c], cx
+    put(0x66); put(0x89); put(0x56); put(2);            //mov [rsi+e], dx
+    put(0x66); put(0x89); put(0x5E); put(4);            //mov [rsi+l], bx
+    put(0x88); put(0x46); put(STATE_A);                  //mov [rsi+a], al
+    put(0x66); put(0x89); put(0x6E); put(8);            //mov [rsi+sp], bp
+    put(0x5F);                                             //pop rdi
+    put(0x5E);                                             //pop rsi
+    put(0x5D);                                             //pop rbp
+    put(0x5B);                                             //pop rbx
+    put(0xC3);                                             //ret
+}
+
+//leaves the block before a store through cx, dx or bx if the target page holds cached code
+void Jit::emitRegisterPageCheck(uint8_t pairRegister, uint16_t pc, uint32_t cycles){
+    put(0x44); put(0x0F); put(0xB7); put(0xD8 | pairRegister);  //movzx r11d, pair
+    put(0x41); put(0xC1); put(0xEB); put(8);                    //shr r11d, 8
+    put(0x66); put(0x43); put(0x83); put(0x3C); put(0x5A); put(0);    //cmp word [r10+r11*2], 0
+    put(0x74); put(0);                                            //je past the exit
+    int jumpFrom = bufferUsed;
+    emitExit(pc, cycles);
+    buffer[jumpFrom - 1] = bufferUsed - jumpFrom;
+}
+
+//leaves the block before a store to a fixed address if its page holds cached code
+void Jit::emitAddressPageCheck(uint16_t address, uint16_t pc, uint32_t cycles){
+    put(0x66); put(0x41); put(0x83); put(0xBA);                 //cmp word [r10+page*2], 0
+    put32((address / CODE_PAGE_SIZE) * 2);
+    put(0);
+    put(0x74); put(0);                                            //je past the exit
+    int jumpFrom = bufferUsed;
+    emitExit(pc, cycles);
+    buffer[jumpFrom - 1] = bufferUsed - jumpFrom;
+}
+
+//merges the x86 flags picked by mask into the 8080 flag byte, DCR needs its aux carry flipped
+void Jit::emitFlagUpdate(uint8_t mask, bool invertAux){
+    put(0x9F);                                             //lahf
+    if(invertAux){
+        put(0x80); put(0xF4); put(AUX_BIT);              //xor ah, AUX_BIT
+    }
+    put(0x80); put(0xE4); put(mask);                     //and ah, mask
+    put(0x80); put(0x66); put(STATE_F); put(~mask);     //and byte [rsi+f], ~mask
+    put(0x08); put(0x66); put(STATE_F);                  //or [rsi+f], ah
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool Jit::emitOp(const BlockCache::DecodedOp &op, uint16_t pc, ...)
+    ** Description: Emits native code for a single instruction at pc. cyclesBefore is the cycle
+        count of the instructions before it, used by exits taken before this one completes.
+        Returns false, emitting nothing, for instructions the Jit leaves to the interpreter.
+        Each translation reproduces exactly what the matching Cpu handler does, including the
+        flags it leaves alone. Exits charge the running cycle sums the block cache built from the
+        Cpu's cycle table, so native code follows the current timing mode.
+**************************************************************************************************/
+bool Jit::emitOp(const BlockCache::DecodedOp &op, uint16_t pc, uint32_t cyclesBefore){
+    uint8_t opcode = op.opcode;
+    uint16_t immediate = (op.high << 8) | op.low;
+    uint8_t destination = (opcode >> 3) & 7;
+    uint8_t source = opcode & 7;
+    uint8_t pair = (opcode >> 4) & 3;
+
+    //MOV group
+    if(opcode >= 0x40 && opcode < 0x80){
+        if(opcode == 0x76){
+            return false;                                   //hlt
+        }
+        if(destination == M_REGISTER){
+            emitRegisterPageCheck(X86_PAIRS[2], pc, cyclesBefore);
+            put(0x88); put(0x04 | X86_REGISTERS[source] << 3); put(0x1F);       //mov [rdi+rbx], r
+        }
+        else if(source == M_REGISTER){
+            put(0x8A); put(0x04 | X86_REGISTERS[destination] << 3); put(0x1F);  //mov r, [rdi+rbx]
+        }
+        else{
+            put(0x88); put(0xC0 | X86_REGISTERS[source] << 3 | X86_REGISTERS[destination]);
+        }
+        return true;
+    }
+
+    //ADD, ADC, ANA, XRA and ORA; the subtracting forms and CMP are left to the interpreter
+    if(opcode >= 0x80 && opcode < 0xC0){
+        uint8_t operation = destination;
+        static const uint8_t X86_ALU[8] = {0x00, 0x10, 0, 0, 0x20, 0x30, 0x08, 0};
+        static const uint8_t ALU_FLAGS[8] = {0xD5, 0xD5, 0, 0, 0xC5, 0xC5, 0xC5, 0};
+        if(operation == 2 || operation == 3 || operation == 7){
+            return false;
+        }
+        if(operation == 1){
+            put(0x8A); put(0x66); put(STATE_F);          //mov ah, [rsi+f]
+            put(0x9E);                                     //sahf
+        }
+        if(source == M_REGISTER){
+            put(X86_ALU[operation] | 0x02); put(0x04); put(0x1F);               //op al, [rdi+rbx]
+        }
+        else{
+            put(X86_ALU[operation]); put(0xC0 | X86_REGISTERS[source] << 3);     //op al, r
+        }
+        emitFlagUpdate(ALU_FLAGS[operation], false);
+        return true;
+    }
+
+    switch(opcode){
+    case 0x00: case 0x08: case 0x10: case 0x18:
+    case 0x20: case 0x28: case 0x30: case 0x38:             //nop and its aliases
+        return true;
+    case 0x01: case 0x11: case 0x21: case 0x31:             //lxi
+        put(0x66); put(0xB8 | X86_PAIRS[pair]); put16(immediate);
+        return true;
+    case 0x03: case 0x13: case 0x23: case 0x33:             //inx
+        put(0x66); put(0xFF); put(0xC0 | X86_PAIRS[pair]);
+        return true;
+    case 0x0B: case 0x1B: case 0x2B: case 0x3B:             //dcx
+        put(0x66); put(0xFF); put(0xC8 | X86_PAIRS[pair]);
+        return true;
+    case 0x09: case 0x19: case 0x29: case 0x39:             //dad, only ever sets the carry
+        put(0x66); put(0x01); put(0xC3 | X86_PAIRS[pair] << 3);         //add bx, pair
+        put(0x73); put(4);                                                //jnc past the or
+        put(0x80); put(0x4E); put(STATE_F); put(CARRY_BIT);            //or byte [rsi+f], CY
+        return true;
+    case 0x02: case 0x12:                                   //stax
+        emitRegisterPageCheck(X86_PAIRS[pair], pc, cyclesBefore);
+        put(0x88); put(0x04); put(0x07 | X86_PAIRS[pair] << 3);         //mov [rdi+pair], al
+        return true;
+    case 0x0A: case 0x1A:                                   //ldax
+        put(0x8A); put(0x04); put(0x07 | X86_PAIRS[pair] << 3);         //mov al, [rdi+pair]
+        return true;
+    case 0x04: case 0x0C: case 0x14: case 0x1C:
+    case 0x24: case 0x2C: case 0x3C:                        //inr
+        put(0xFE); put(0xC0 | X86_REGISTERS[destination]);
+        emitFlagUpdate(SIGN_BIT | ZERO_BIT | AUX_BIT | PARITY_BIT, false);
+        return true;
+    case 0x05: case 0x0D: case 0x15: case 0x1D:
+    case 0x25: case 0x2D: case 0x3D:                        //dcr
+        put(0xFE); put(0xC8 | X86_REGISTERS[destination]);
+        emitFlagUpdate(SIGN_BIT | ZERO_BIT | AUX_BIT | PARITY_BIT, true);
+        return true;
+    case 0x34:                                              //inr m
+        emitRegisterPageCheck(X86_PAIRS[2], pc, cyclesBefore);
+        put(0xFE); put(0x04); put(0x1F);
+        emitFlagUpdate(SIGN_BIT | ZERO_BIT | AUX_BIT | PARITY_BIT, false);
+        return true;
+    case 0x35:                                              //dcr m
+        emitRegisterPageCheck(X86_PAIRS[2], pc, cyclesBefore);
+        put(0xFE); put(0x0C); put(0x1F);
+        emitFlagUpdate(SIGN_BIT | ZERO_BIT | AUX_BIT | PARITY_BIT, true);
+        return true;
+    case 0x06: case 0x0E: case 0x16: case 0x1E:
+    case 0x26: case 0x2E: case 0x3E:                        //mvi
+        put(0xB0 | X86_REGISTERS[destination]); put(op.low);
+        return true;
+    case 0x36:                                              //mvi m
+        emitRegisterPageCheck(X86_PAIRS[2], pc, cyclesBefore);
+        put(0xC6); put(0x04); put(0x1F); put(op.low);
+        return true;
+    case 0x07:                                              //rlc
+        put(0xD0); put(0xC0);
+        emitFlagUpdate(CARRY_BIT, false);
+        return true;
+    case 0x0F:                                              //rrc
+        put(0xD0); put(0xC8);
+        emitFlagUpdate(CARRY_BIT, false);
+        return true;
+    case 0x17:                                              //ral
+    case 0x1F:                                              //rar
+        put(0x8A); put(0x66); put(STATE_F);              //mov ah, [rsi+f]
+        put(0x9E);                                         //sahf
+        put(0xD0); put(opcode == 0x17 ? 0xD0 : 0xD8);     //rcl/rcr al, 1
+        emitFlagUpdate(CARRY_BIT, false);
+        return true;
+    case 0x22:                                              //shld
+        if(immediate == 0xFFFF){
+            return false;
+        }
+        emitAddressPageCheck(immediate, pc, cyclesBefore);
+        emitAddressPageCheck(immediate + 1, pc, cyclesBefore);
+        put(0x66); put(0x89); put(0x9F); put32(immediate);             //mov [rdi+addr], bx
+        return true;
+    case 0x2A:                                              //lhld
+        if(immediate == 0xFFFF){
+            return false;
+        }
+        put(0x66); put(0x8B); put(0x9F); put32(immediate);             //mov bx, [rdi+addr]
+        return true;
+    case 0x32:                                              //sta
+        emitAddressPageCheck(immediate, pc, cyclesBefore);
+        put(0x88); put(0x87); put32(immediate);                          //mov [rdi+addr], al
+        return true;
+    case 0x3A:                                              //lda
+        put(0x8A); put(0x87); put32(immediate);                          //mov al, [rdi+addr]
+        return true;
+    case 0x2F:                                              //cma
+        put(0xF6); put(0xD0);
+        return true;
+    case 0x37:                                              //stc
+        put(0x80); put(0x4E); put(STATE_F); put(CARRY_BIT);
+        return true;
+    case 0x3F:                                              //cmc
+        put(0x80); put(0x76); put(STATE_F); put(CARRY_BIT);
+        return true;
+    case 0xE6:                                              //ani
+    case 0xEE:                                              //xri
+    case 0xF6:                                              //ori
+    case 0xC6:                                              //adi
+        put(opcode == 0xE6 ? 0x24 : opcode == 0xEE ? 0x34 : opcode == 0xF6 ? 0x0C : 0x04);
+        put(op.low);
+        emitFlagUpdate(opcode == 0xC6 ? 0xD5 : 0xC5, false);
+        return true;
+    case 0xCE:                                              //aci
+        put(0x8A); put(0x66); put(STATE_F);              //mov ah, [rsi+f]
+        put(0x9E);                                         //sahf
+        put(0x14); put(op.low);                           //adc al, imm8
+        emitFlagUpdate(0xD5, false);
+        return true;
+    case 0xEB:                                              //xchg
+        put(0x66); put(0x87); put(0xD3);
+        return true;
+    case 0xF9:                                              //sphl
+        put(0x66); put(0x89); put(0xDD);
+        return true;
+    case 0xC3: case 0xCB:                                   //jmp
+        emitExit(immediate, op.cycleSum);
+        return true;
+    case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+    case 0xE2: case 0xEA: case 0xF2: case 0xFA:             //conditional jumps
+    {
+        static const uint8_t CONDITION_BITS[4] = {ZERO_BIT, CARRY_BIT, PARITY_BIT, SIGN_BIT};
+        bool takenWhenSet = (opcode & 0x08) != 0;
+        put(0xF6); put(0x46); put(STATE_F); put(CONDITION_BITS[pair]);  //test byte [rsi+f], bit
+        put(takenWhenSet ? 0x74 : 0x75); put(0);          //skip the taken exit if not taken
+        int jumpFrom = bufferUsed;
+        emitExit(immediate, op.cycleSum);
+        buffer[jumpFrom - 1] = bufferUsed - jumpFrom;
+        emitExit(pc + 3, op.cycleSum);
+        return true;
+    }
+    case 0xE9:                                              //pchl
+        emitExitToHL(op.cycleSum);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,81 @@
+/**************************************************************************************************
+    ** File Name: jit.h
+    ** Description: This file contains the Class declaration for the Jit class, an optional
+        dynamic recompiler that translates hot basic blocks from the Cpu's block cache into
+        native x86-64 code. The 8080 registers are kept in x86 registers while a block runs,
+        cycles are counted at the block's exits, and anything the translator does not handle
+        (I/O, stack operations, interrupts) is left to the interpreter.
+**************************************************************************************************/
+#include "../cpu/cpu.h"
+
+#ifndef JIT_H
+#define JIT_H
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_SUPPORTED
+#endif
+
+const int HOT_BLOCK_THRESHOLD = 16;             //block entries before it gets translated
+const int JIT_BUFFER_SIZE = 0x100000;           //bytes of executable memory for native code
+const int JIT_MAX_BLOCK_SIZE = 0x1000;          //room reserved for translating a single block
+
+class Jit
+{
+public:
+    Jit(Cpu *cpu);                              //constructor
+    ~Jit();                                     //destructor
+
+    bool start();                               //gets executable memory, false if unavailable
+    int run();                                  //runs one block, natively when it is hot
+
+    bool enabled;                               //set once start succeeds
+    bool verify;                                //check native blocks against the interpreter
+
+private:
+    //the 8080 state as seen by native code, offsets are baked into the generated code
+    struct JitState{
+        uint8_t c;                              //c and b load together as the BC pair
+        uint8_t b;
+        uint8_t e;
+        uint8_t d;
+        uint8_t l;
+        uint8_t h;
+        uint8_t a;
+        uint8_t f;                              //flag register as built by Flags
+        uint16_t sp;
+        uint16_t pc;                            //written by the exit the block left through
+        uint32_t cycles;                        //written by the exit the block left through
+        uint8_t *memory;
+        const uint16_t *codePages;
+    };
+    typedef void (*NativeBlock)(JitState *state);
+
+    Cpu *cpu;
+    uint8_t *buffer;                            //executable memory holding translated blocks
+    int bufferUsed;
+    uint8_t *shadowMemory;                      //copy of memory native code runs on when verifying
+
+    void compile(BlockCache::Block *block);
+    int runNative(BlockCache::Block *block);
+    int runVerified(BlockCache::Block *block);
+    void loadState(JitState &state, uint8_t *memory);
+    void storeState(const JitState &state);
+
+    bool makeWritable();
+    bool makeExecutable();
+
+    //code emission helpers, all write at buffer + bufferUsed
+    void put(uint8_t byte);
+    void put16(uint16_t value);
+    void put32(uint32_t value);
+    void emitPrologue();
+    void emitExit(uint16_t pc, uint32_t cycles);
+    void emitExitToHL(uint32_t cycles);
+    void emitExitTail(uint32_t cycles);
+    void emitRegisterPageCheck(uint8_t pairRegister, uint16_t pc, uint32_t cycles);
+    void emitAddressPageCheck(uint16_t address, uint16_t pc, uint32_t cycles);
+    void emitFlagUpdate(uint8_t mask, bool invertAux);
+    bool emitOp(const BlockCache::DecodedOp &op, uint16_t pc, uint32_t cyclesBefore);
+};
+
+#endif // JIT_H
@@ -0,0 +1,103 @@
+/**************************************************************************************************
+    ** File Name: latencyMonitor.cpp
+    ** Description: Contains the member function definitions for the LatencyMonitor class.
+**************************************************************************************************/
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+
+#include "latencyMonitor.h"
+#include "../concurrency/hostClock.h"
+
+
+//the default constructor for the LatencyMonitor class, starts with no presses recorded
+LatencyMonitor::LatencyMonitor()
+{
+    hasPending = false;
+    dropped = 0;
+}
+
+//queues a press for the gui thread, which finishes it once frame is on screen
+void LatencyMonitor::inputTaken(int key, bool pressed, int64_t pressTime, int64_t takenTime,
+                                uint64_t frame){
+    Record record = {key, pressed, pressTime, takenTime, 0, frame};
+    if(!taken.push(record)){
+        dropped++;
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void LatencyMonitor::framePresented(uint64_t frame)
+    ** Description: Stamps every queued press waiting on frame, or on an earlier frame that was
+        never presented, with the time now and keeps it for the report. Presses waiting on a
+        later frame stay queued.
+**************************************************************************************************/
+void LatencyMonitor::framePresented(uint64_t frame){
+    int64_t now = hostNanoseconds();
+    while(hasPending || taken.pop(pending)){
+        hasPending = true;
+        if(pending.frame > frame){
+            return;
+        }
+        pending.presentTime = now;
+        records.append(pending);
+        hasPending = false;
+    }
+}
+
+//returns the value percent of the way through sorted, by the nearest rank
+int64_t LatencyMonitor::percentile(QVector<int64_t> &sorted, int percent){
+    int rank = (sorted.size() * percent + 99) / 100;
+    return sorted[qMax(rank, 1) - 1];
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void LatencyMonitor::report()
+    ** Description: Logs the 50th and 99th percentile and the worst of the time from key press
+        to screen over every press presented, along with the part of it spent waiting for the
+        emulation to take the press. Only called once the emulation has stopped.
+**************************************************************************************************/
+void LatencyMonitor::report(){
+    if(records.isEmpty()){
+        return;
+    }
+    QVector<int64_t> photon;
+    QVector<int64_t> input;
+    for(const Record &record : records){
+        photon.append(record.presentTime - record.pressTime);
+        input.append(record.takenTime - record.pressTime);
+    }
+    std::sort(photon.begin(), photon.end());
+    std::sort(input.begin(), input.end());
+    qDebug("Input to photon latency over %d presses: p50 %.2f ms, p99 %.2f ms, worst %.2f ms "
+           "(waiting to be taken: p50 %.2f ms, p99 %.2f ms), %llu not measured",
+           records.size(), percentile(photon, 50) / 1e6, percentile(photon, 99) / 1e6,
+           photon.last() / 1e6, percentile(input, 50) / 1e6, percentile(input, 99) / 1e6,
+           (unsigned long long)dropped);
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool LatencyMonitor::writeRecords(const QString &path)
+    ** Description: Writes every presented press to path as csv, one line each with the key, the
+        frame it first could appear in and its times in nanoseconds from the first press. Returns
+        false if the file cannot be opened.
+**************************************************************************************************/
+bool LatencyMonitor::writeRecords(const QString &path){
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)){
+        return false;
+    }
+    QTextStream out(&file);
+    out << "key,pressed,frame,press_ns,taken_ns,present_ns,latency_ns\n";
+    int64_t start = records.isEmpty() ? 0 : records.first().pressTime;
+    for(const Record &record : records){
+        out << record.key << ',' << (record.pressed ? 1 : 0) << ',' << record.frame << ','
+            << record.pressTime - start << ',' << record.takenTime - start << ','
+            << record.presentTime - start << ',' << record.presentTime - record.pressTime << '\n';
+    }
+    return true;
+}
@@ -0,0 +1,55 @@
+/**************************************************************************************************
+    ** File Name: latencyMonitor.h
+    ** Description: This file contains the Class declaration for the LatencyMonitor class, which
+        measures input to photon latency: the time from a key press reaching the emulator to
+        the first frame that could show it reaching the screen. The emulation thread tags each
+        key press it takes with the frame that will be the first generated after it, and the
+        gui thread stamps each frame as it puts it on screen, so the two times meet here. The
+        report gives the latency percentiles over the session and can save every press.
+**************************************************************************************************/
+#include <QString>
+#include <QVector>
+#include <stdint.h>
+
+#include "../concurrency/spscQueue.h"
+
+#ifndef LATENCYMONITOR_H
+#define LATENCYMONITOR_H
+
+const int LATENCY_QUEUE_SLOTS = 256;            //taken key presses that can wait for their frame
+
+
+class LatencyMonitor
+{
+public:
+    LatencyMonitor();                           //default constructor
+
+    //called from the emulation thread when a key press is applied to the input ports
+    void inputTaken(int key, bool pressed, int64_t pressTime, int64_t takenTime, uint64_t frame);
+    //called from the gui thread once frame is on screen
+    void framePresented(uint64_t frame);
+
+    void report();                              //logs the percentiles, once both threads stop
+    bool writeRecords(const QString &path);     //saves every press as csv, false on failure
+
+private:
+    //a key press on its way from the keyboard to the screen, times are from hostNanoseconds
+    struct Record{
+        int key;
+        bool pressed;
+        int64_t pressTime;                      //when the gui handed it to the emulator
+        int64_t takenTime;                      //when the emulation applied it to the ports
+        int64_t presentTime;                    //when the first frame after it was put on screen
+        uint64_t frame;
+    };
+
+    static int64_t percentile(QVector<int64_t> &sorted, int percent);
+
+    SpscQueue<Record, LATENCY_QUEUE_SLOTS> taken;
+    Record pending;                             //taken off the queue but its frame is not up yet
+    bool hasPending;
+    uint64_t dropped;                           //presses lost to a full queue, emulation thread only
+    QVector<Record> records;                    //presented presses, gui thread only
+};
+
+#endif // LATENCYMONITOR_H
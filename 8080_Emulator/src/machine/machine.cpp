@@ -0,0 +1,146 @@
+/**************************************************************************************************
+    ** File Name: machine.cpp
+    ** Description: Contains the descriptions of the boards the emulator can run and the member
+        function definitions for the Machine struct. The Taito boards' checksums are left for
+        whoever adds their dumps, so their files are only checked for size.
+**************************************************************************************************/
+#include "machine.h"
+
+//the control panel shared by every board: the player 1 and 2 controls, the start buttons and
+//the coin slot, all on input1 and input2 in the same places
+static const KeyBinding STANDARD_KEYS[] = {
+    {Qt::Key_C, 1, 1, 0},                               //coin
+    {Qt::Key_2, 1, 1 << 1, KEY_TWO_PLAYER_START},       //2 player start
+    {Qt::Key_1, 1, 1 << 2, 0},                          //player 1 start
+    {Qt::Key_W, 1, 1 << 4, 0},                          //player 1 fire
+    {Qt::Key_A, 1, 1 << 5, 0},                          //player 1 left
+    {Qt::Key_D, 1, 1 << 6, 0},                          //player 1 right
+    {Qt::Key_Up, 2, 1 << 4, KEY_PLAYER_TWO},            //player 2 fire
+    {Qt::Key_Left, 2, 1 << 5, KEY_PLAYER_TWO},          //player 2 left
+    {Qt::Key_Right, 2, 1 << 6, KEY_PLAYER_TWO},         //player 2 right
+    {0, 0, 0, 0}
+};
+
+//the ports of the Space Invaders board, which the Taito boards copied. Part II keeps the sound
+//latches on ports 3 and 5 and drives much the same sounds, so it plays the Invaders samples and
+//synth voices on purpose
+static const PortMap STANDARD_PORTS = {{0, 1, 2}, 3, 2, 4, {3, 5}, 6};
+
+//Lunar Rescue and Balloon Bomber play their own sounds, which there are no samples or synth
+//voices for yet, so their sound latches are left unconnected
+static const PortMap SILENT_PORTS = {{0, 1, 2}, 3, 2, 4, {-1, -1}, 6};
+
+static const Machine MACHINES[] = {
+    {
+        "invaders", "Space Invaders (Midway)",
+        4, {
+            {"invaders.h", 0x0000, 0x800, 0x734F5AD8, "ff6200af4c9110d8181249cbcef1a8a40fa40b7f", false},
+            {"invaders.g", 0x0800, 0x800, 0x6BFACA4A, "16f48649b531bdef8c2d1446c429b5f414524350", false},
+            {"invaders.f", 0x1000, 0x800, 0x0CCEAD96, "537aef03468f63c5b9e11dd61e253f7ae17d9743", false},
+            {"invaders.e", 0x1800, 0x800, 0x14E538B0, "1d6ca0c99f9df71e2990b610deb9d7da0125e2d8", false}
+        },
+        "invaders.rom", 0xB64CA815, "2c6e7301635fcb5c9b845a97fcb2632eb7fbcbf8",
+        STANDARD_PORTS, {0b01110000, 0b00001000, 0},
+        96, 0xCF, 0xD7,                         //rst 1 and rst 2
+        5, {{0, Qt::white}, {16, Qt::green}, {72, Qt::white}, {192, Qt::red}, {224, Qt::white}},
+        STANDARD_KEYS
+    },
+    {
+        "invadpt2", "Space Invaders Part II (Taito)",
+        7, {
+            {"pv01", 0x0000, 0x800, 0, nullptr, false},
+            {"pv02", 0x0800, 0x800, 0, nullptr, false},
+            {"pv03", 0x1000, 0x800, 0, nullptr, false},
+            {"pv04", 0x1800, 0x800, 0, nullptr, false},
+            {"pv05", 0x4000, 0x800, 0, nullptr, false},
+            {"pv06.1", 0x000, 0x400, 0, nullptr, true},
+            {"pv07.2", 0x400, 0x400, 0, nullptr, true}
+        },
+        nullptr, 0, nullptr,
+        STANDARD_PORTS, {0, 0b00001000, 0},
+        96, 0xCF, 0xD7,
+        0, {},
+        STANDARD_KEYS
+    },
+    {
+        "lrescue", "Lunar Rescue (Taito)",
+        7, {
+            {"lrescue.1", 0x0000, 0x800, 0, nullptr, false},
+            {"lrescue.2", 0x0800, 0x800, 0, nullptr, false},
+            {"lrescue.3", 0x1000, 0x800, 0, nullptr, false},
+            {"lrescue.4", 0x1800, 0x800, 0, nullptr, false},
+            {"lrescue.5", 0x4000, 0x800, 0, nullptr, false},
+            {"lrescue.6", 0x4800, 0x800, 0, nullptr, false},
+            {"7643-1.cpu", 0x000, 0x400, 0, nullptr, true}
+        },
+        nullptr, 0, nullptr,
+        SILENT_PORTS, {0, 0b00001000, 0},
+        96, 0xCF, 0xD7,
+        0, {},
+        STANDARD_KEYS
+    },
+    {
+        "ballbomb", "Balloon Bomber (Taito)",
+        7, {
+            {"tn01", 0x0000, 0x800, 0, nullptr, false},
+            {"tn02", 0x0800, 0x800, 0, nullptr, false},
+            {"tn03", 0x1000, 0x800, 0, nullptr, false},
+            {"tn04", 0x1800, 0x800, 0, nullptr, false},
+            {"tn05-1", 0x4000, 0x800, 0, nullptr, false},
+            {"tn06", 0x000, 0x400, 0, nullptr, true},
+            {"tn07", 0x400, 0x400, 0, nullptr, true}
+        },
+        nullptr, 0, nullptr,
+        SILENT_PORTS, {0, 0b00001000, 0},
+        96, 0xCF, 0xD7,
+        0, {},
+        STANDARD_KEYS
+    }
+};
+static const int MACHINE_COUNT = sizeof(MACHINES) / sizeof(MACHINES[0]);
+
+
+//returns true if the board colours its screen from a colour prom instead of an overlay
+bool Machine::hasColourProm() const{
+    for(int i = 0; i < romCount; ++i){
+        if(roms[i].colourProm){
+            return true;
+        }
+    }
+    return false;
+}
+
+//returns the bytes of program rom the board has, the size its joined image must be
+int Machine::imageSize() const{
+    int size = 0;
+    for(int i = 0; i < romCount; ++i){
+        if(!roms[i].colourProm){
+            size += roms[i].size;
+        }
+    }
+    return size;
+}
+
+//returns the board with the MAME name given, or null if there is none
+const Machine* Machine::find(const QString &name){
+    for(int i = 0; i < MACHINE_COUNT; ++i){
+        if(name == MACHINES[i].name){
+            return &MACHINES[i];
+        }
+    }
+    return nullptr;
+}
+
+//returns the original Space Invaders board
+const Machine& Machine::standard(){
+    return MACHINES[0];
+}
+
+//returns the MAME names of every board, for --machine's help and errors
+QStringList Machine::names(){
+    QStringList names;
+    for(int i = 0; i < MACHINE_COUNT; ++i){
+        names << MACHINES[i].name;
+    }
+    return names;
+}
@@ -0,0 +1,94 @@
+/**************************************************************************************************
+    ** File Name: machine.h
+    ** Description: This file contains the Machine struct, the description of one of the Midway
+        and Taito 8080 boards the emulator can run. The boards share the Cpu, the screen and
+        the interrupt timing of the Space Invaders hardware and differ in where their roms go,
+        which ports their inputs, shift register, sounds and watchdog sit on, how the picture
+        is coloured and which input bits the controls drive. Each board is picked by its MAME
+        name with --machine, and nothing else in the emulator needs to know which one it is.
+**************************************************************************************************/
+#include <QColor>
+#include <QStringList>
+#include <stdint.h>
+
+#ifndef MACHINE_H
+#define MACHINE_H
+
+const int MACHINE_MAX_ROMS = 8;                 //rom files in a board's MAME set
+const int MACHINE_MAX_BANDS = 8;                //colour bands in an overlay
+const int COLOUR_PROM_SIZE = 0x800;             //room for the biggest board's colour proms
+
+//a file of a board's MAME set. crc is 0 and sha1 null where the checksums are not listed here
+struct MachineRom{
+    const char *fileName;
+    uint16_t address;                           //where it goes in memory, or in the colour prom
+    uint16_t size;
+    uint32_t crc;
+    const char *sha1;
+    bool colourProm;                            //colours the screen rather than holding code
+};
+
+//the ports a board's I/O is on, -1 where it has none
+struct PortMap{
+    int inputs[3];                              //read as the Cpu's input0, input1 and input2
+    int shiftResult;                            //the shift register's result
+    int shiftAmount;
+    int shiftData;
+    int sounds[2];                              //latches the sound source plays as its port 3 and 5
+    int watchdog;
+};
+
+//a strip of the coloured film stuck over a black and white monitor, covering the unrotated
+//screen from x = first up to the next band
+struct OverlayBand{
+    int first;
+    Qt::GlobalColor colour;
+};
+
+//flags of a KeyBinding
+const int KEY_PLAYER_TWO = 1;                   //ignored until a two player game is started
+const int KEY_TWO_PLAYER_START = 2;             //starts a two player game
+
+//a key and the bits it holds set in one of the Cpu's input latches while it is down
+struct KeyBinding{
+    int key;                                    //0 ends a list of bindings
+    int input;                                  //0 to 2 for input0 to input2
+    uint8_t bits;
+    int flags;
+};
+
+struct Machine{
+    const char *name;                           //MAME's short name, given to --machine
+    const char *title;
+
+    //memory map. The program roms are copied into memory below the work RAM at 0x2000, and a
+    //board whose set has a single file of them joined together names it in image
+    int romCount;
+    MachineRom roms[MACHINE_MAX_ROMS];
+    const char *image;
+    uint32_t imageCrc;
+    const char *imageSha1;
+
+    PortMap ports;
+    uint8_t inputDefaults[3];                   //input0 to input2 with nothing pressed
+
+    //interrupts, sent as the beam reaches the middle and the bottom of the screen
+    int midScreenLine;
+    uint8_t midScreenOpcode;
+    uint8_t endOfScreenOpcode;
+
+    //boards with a colour prom take each 8x8 block's colour from it, the others use an overlay
+    int overlayBands;
+    OverlayBand overlay[MACHINE_MAX_BANDS];
+
+    const KeyBinding *keys;
+
+    bool hasColourProm() const;
+    int imageSize() const;                      //bytes of program rom in image
+
+    static const Machine* find(const QString &name);    //null if there is no such board
+    static const Machine& standard();           //Space Invaders, used when no board is picked
+    static QStringList names();
+};
+
+#endif // MACHINE_H
@@ -6,9 +6,31 @@
 
 #include "mainwindow.h"
 #include "src/gui/gui.h"
+#include "src/options/options.h"
+#include "src/trace/traceReader.h"
+#include "src/conformance/cpmRunner.h"
+#include "src/fuzz/fuzzer.h"
+#include "src/benchmark/benchmark.h"
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    Options::instance().parse(a.arguments());
+
+    //comparing traces is done from the command line without opening the game
+    if(!Options::instance().traceDiff.isEmpty()){
+        return TraceReader::diff(Options::instance().traceDiff[0], Options::instance().traceDiff[1]);
+    }
+    if(!Options::instance().cpmPrograms.isEmpty()){
+        return CpmRunner::runAll(Options::instance().cpmPrograms);
+    }
+    if(Options::instance().fuzzCases > 0){
+        Fuzzer fuzzer(Options::instance().fuzzSeed);
+        return fuzzer.run(Options::instance().fuzzCases);
+    }
+    if(!Options::instance().benchmarkPath.isEmpty()){
+        Benchmark benchmark;
+        return benchmark.run(Options::instance().benchmarkPath);
+    }
     MainWindow main;
     main.show();
     return a.exec();
@@ -0,0 +1,132 @@
+/**************************************************************************************************
+    ** File Name: metrics.cpp
+    ** Description: Contains the member function definitions for the Histogram and Metrics
+        classes.
+**************************************************************************************************/
+#include <QTextStream>
+#include <QtCore/qalgorithms.h>
+
+#include "metrics.h"
+
+
+//the default constructor for the Histogram class, starts with every bucket empty
+Histogram::Histogram()
+{
+    for(int bucket = 0; bucket <= METRICS_BUCKETS; ++bucket){
+        buckets[bucket].store(0, std::memory_order_relaxed);
+    }
+}
+
+//counts one duration in its bucket
+void Histogram::record(int64_t nanoseconds){
+    if(nanoseconds < 0){
+        nanoseconds = 0;
+    }
+    buckets[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    count.add();
+    sum.add(nanoseconds);
+}
+
+
+/**************************************************************************************************
+    ** Function Name: int Histogram::bucketOf(int64_t nanoseconds)
+    ** Description: Returns the bucket a duration is counted in. The power of two below the
+        value picks the octave and the METRICS_SUB_BUCKET_BITS bits after the top one pick the step
+        within it. Everything under the first octave shares the first bucket and everything
+        past the last octave goes in the overflow bucket, METRICS_BUCKETS.
+**************************************************************************************************/
+int Histogram::bucketOf(int64_t nanoseconds){
+    int octave = 63 - qCountLeadingZeroBits((quint64)nanoseconds | 1);
+    if(octave < METRICS_FIRST_OCTAVE){
+        return 0;
+    }
+    int step = (nanoseconds >> (octave - METRICS_SUB_BUCKET_BITS)) & (METRICS_SUB_BUCKETS - 1);
+    int bucket = (octave - METRICS_FIRST_OCTAVE) * METRICS_SUB_BUCKETS + step;
+    return bucket < METRICS_BUCKETS ? bucket : METRICS_BUCKETS;
+}
+
+//returns the largest duration counted in bucket, the start of the next one less a nanosecond
+int64_t Histogram::upperBound(int bucket){
+    int octave = METRICS_FIRST_OCTAVE + bucket / METRICS_SUB_BUCKETS;
+    int step = bucket % METRICS_SUB_BUCKETS;
+    return ((int64_t)1 << octave) + ((int64_t)(step + 1) << (octave - METRICS_SUB_BUCKET_BITS)) - 1;
+}
+
+//returns the metrics shared by the whole program
+Metrics& Metrics::instance(){
+    static Metrics metrics;
+    return metrics;
+}
+
+//writes a counter with its help line
+static void writeCounter(QTextStream &out, const char *name, const char *help, uint64_t value){
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << " counter\n";
+    out << name << ' ' << value << '\n';
+}
+
+
+/**************************************************************************************************
+    ** Function Name: static void writeHistogram(QTextStream &out, const char *name, ...)
+    ** Description: Writes a histogram in seconds with its help line: a cumulative count for
+        every bucket's upper bound, then +Inf, the sum and the count. The buckets are read one
+        at a time while they may still be changing, so a scrape can be a few records out of
+        step between buckets, which Prometheus tolerates.
+**************************************************************************************************/
+static void writeHistogram(QTextStream &out, const char *name, const char *help,
+                           const Histogram &histogram){
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << " histogram\n";
+    uint64_t cumulative = 0;
+    for(int bucket = 0; bucket < METRICS_BUCKETS; ++bucket){
+        cumulative += histogram.buckets[bucket].load(std::memory_order_relaxed);
+        double bound = (Histogram::upperBound(bucket) + 1) / 1e9;
+        out << name << "_bucket{le=\"" << QString::number(bound, 'g', 6) << "\"} "
+            << cumulative << '\n';
+    }
+    cumulative += histogram.buckets[METRICS_BUCKETS].load(std::memory_order_relaxed);
+    out << name << "_bucket{le=\"+Inf\"} " << cumulative << '\n';
+    out << name << "_sum " << QString::number(histogram.sum.read() / 1e9, 'f', 9) << '\n';
+    out << name << "_count " << cumulative << '\n';
+}
+
+
+/**************************************************************************************************
+    ** Function Name: QByteArray Metrics::exposition(double clockHertz)
+    ** Description: Returns every metric in the Prometheus text exposition format, durations in
+        seconds as Prometheus expects. clockHertz is worked out by the caller from the cycles
+        counter, as it depends on when that caller last looked.
+**************************************************************************************************/
+QByteArray Metrics::exposition(double clockHertz){
+    QByteArray text;
+    QTextStream out(&text);
+    writeCounter(out, "emulator_frames_total", "Frames emulated.", frames.read());
+    writeCounter(out, "emulator_cycles_total", "8080 cycles run in those frames.", cycles.read());
+    out << "# HELP emulator_clock_hertz Emulated clock rate since the last export, "
+           "1996800 is full speed.\n";
+    out << "# TYPE emulator_clock_hertz gauge\n";
+    out << "emulator_clock_hertz " << QString::number(clockHertz, 'f', 0) << '\n';
+    writeCounter(out, "emulator_interrupt_retries_total",
+                 "Attempts to send an interrupt while the cpu had them disabled.",
+                 interruptRetries.read());
+    writeCounter(out, "emulator_frames_dropped_total",
+                 "Frames finished under half a frame after the last, too soon to be seen.",
+                 framesDropped.read());
+    writeCounter(out, "emulator_frames_duplicated_total",
+                 "Frame periods that passed without a new frame, so the last one was shown again.",
+                 framesDuplicated.read());
+    writeCounter(out, "emulator_audio_underruns_total", "Times the audio output ran dry.",
+                 audioUnderruns.read());
+    writeHistogram(out, "emulator_frame_emulation_seconds",
+                   "Time each frame spent running the cpu.", frameEmulation);
+    writeHistogram(out, "emulator_frame_render_seconds",
+                   "Time each frame spent painting the screen and sending it to the gui.",
+                   frameRender);
+    writeHistogram(out, "emulator_frame_wait_seconds",
+                   "Time each frame spent sleeping or spinning until its interrupts were due.",
+                   frameWait);
+    writeHistogram(out, "emulator_frame_interval_seconds",
+                   "Time from the end of one frame to the next.", frameInterval);
+    out.flush();
+    return text;
+}
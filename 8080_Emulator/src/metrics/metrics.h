@@ -0,0 +1,77 @@
+/**************************************************************************************************
+    ** File Name: metrics.h
+    ** Description: This file contains the Counter and Histogram classes and the Metrics class
+        that holds one of each thing the emulator measures about how it is running. Every update
+        is a relaxed atomic add, so the emulation and audio threads can count as they go and the
+        exporter thread can read at any time without either side waiting. Histograms use HDR
+        style buckets: each power of two is split into METRICS_SUB_BUCKETS linear steps, which
+        keeps the error under 25% from a microsecond to a couple of seconds in a fixed, small
+        table. The MetricsExporter serves them in the Prometheus text format.
+**************************************************************************************************/
+#include <QByteArray>
+#include <atomic>
+#include <stdint.h>
+
+#ifndef METRICS_H
+#define METRICS_H
+
+const int METRICS_FIRST_OCTAVE = 10;            //the smallest bucket ends past 2^10 ns, about 1 us
+const int METRICS_OCTAVES = 21;                 //powers of two covered, up to about 2 s
+const int METRICS_SUB_BUCKET_BITS = 2;          //bits after the top one that pick the step
+const int METRICS_SUB_BUCKETS = 1 << METRICS_SUB_BUCKET_BITS;  //steps each power of two is split into
+const int METRICS_BUCKETS = METRICS_OCTAVES * METRICS_SUB_BUCKETS;
+
+
+//a count that only goes up, such as frames run or underruns
+class Counter
+{
+public:
+    Counter() : value(0) {}
+    void add(uint64_t amount = 1){ value.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t read() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value;
+};
+
+
+//how often durations in nanoseconds fell in each bucket, along with their count and sum
+class Histogram
+{
+public:
+    Histogram();
+    void record(int64_t nanoseconds);
+
+    static int bucketOf(int64_t nanoseconds);
+    static int64_t upperBound(int bucket);      //largest value in bucket, in nanoseconds
+
+    std::atomic<uint64_t> buckets[METRICS_BUCKETS + 1];    //the last holds everything larger
+    Counter count;
+    Counter sum;                                //nanoseconds
+};
+
+
+class Metrics
+{
+public:
+    static Metrics& instance();                 //the metrics shared by the whole program
+
+    //the text Prometheus scrapes, clockHertz is the emulated clock rate since the last export
+    QByteArray exposition(double clockHertz);
+
+    Counter frames;                             //frames emulated by run
+    Counter cycles;                             //cpu cycles in those frames
+    Counter interruptRetries;                   //attempts to interrupt while the cpu disabled them
+    Counter framesDropped;                      //frames too close to the last for a display to show
+    Counter framesDuplicated;                   //display refreshes that got no new frame
+    Counter audioUnderruns;                     //times the audio output ran dry
+    Histogram frameEmulation;                   //time a frame spent running the cpu
+    Histogram frameRender;                      //time a frame spent painting and sending the screen
+    Histogram frameWait;                        //time a frame spent sleeping or spinning on the clock
+    Histogram frameInterval;                    //time from the end of one frame to the next
+
+private:
+    Metrics(){}                                 //default constructor
+};
+
+#endif // METRICS_H
@@ -0,0 +1,109 @@
+/**************************************************************************************************
+    ** File Name: metricsExporter.cpp
+    ** Description: Contains the member function definitions for the MetricsExporter class.
+**************************************************************************************************/
+#include <QDebug>
+#include <QHostAddress>
+#include <QSaveFile>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include "metricsExporter.h"
+#include "../concurrency/hostClock.h"
+#include "../options/options.h"
+
+
+//the default constructor for the MetricsExporter class, takes the port, file and interval from
+//the command line
+MetricsExporter::MetricsExporter()
+{
+    port = Options::instance().metricsPort;
+    path = Options::instance().metricsPath;
+    interval = Options::instance().metricsInterval;
+    lastCycles = 0;
+    lastTime = hostNanoseconds();
+}
+
+//destructor for the MetricsExporter class, stops the thread if it is still running
+MetricsExporter::~MetricsExporter(){
+    stop();
+}
+
+//checks if the metrics go anywhere, the thread is not worth starting otherwise
+bool MetricsExporter::isEnabled(){
+    return port != 0 || !path.isEmpty();
+}
+
+//ends the thread's event loop and waits for it, then writes the file with the final counts
+void MetricsExporter::stop(){
+    if(isRunning()){
+        quit();
+        wait();
+        if(!path.isEmpty()){
+            writeFile();
+        }
+    }
+}
+
+//returns the metrics, working out the emulated clock rate from the cycles run since last time
+QByteArray MetricsExporter::exposition(){
+    uint64_t cycles = Metrics::instance().cycles.read();
+    int64_t now = hostNanoseconds();
+    double hertz = now > lastTime ? (cycles - lastCycles) * 1e9 / (now - lastTime) : 0.0;
+    lastCycles = cycles;
+    lastTime = now;
+    return Metrics::instance().exposition(hertz);
+}
+
+//replaces the textfile with the current metrics in one step, so a collector never reads half
+bool MetricsExporter::writeFile(){
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly)){
+        return false;
+    }
+    file.write(exposition());
+    return file.commit();
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void MetricsExporter::run()
+    ** Description: Listens on the loopback address for scrapes and starts the textfile timer,
+        then runs the event loop until stop. Every connection gets the metrics as a plain HTTP
+        response once its request has arrived, whatever path it asked for, and is closed. The
+        server and timer are made here so they belong to this thread.
+**************************************************************************************************/
+void MetricsExporter::run(){
+    QTcpServer server;
+    if(port != 0 && !server.listen(QHostAddress::LocalHost, port)){
+        qWarning("Failed to serve metrics on port %d: %s", port, qPrintable(server.errorString()));
+    }
+    connect(&server, &QTcpServer::newConnection, [&](){
+        QTcpSocket *socket = server.nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, [this, socket](){
+            if(!socket->peek(socket->bytesAvailable()).contains("\r\n\r\n")){
+                return;                         //the request has not all arrived yet
+            }
+            socket->readAll();
+            QByteArray body = exposition();
+            socket->write("HTTP/1.0 200 OK\r\n"
+                          "Content-Type: text/plain; version=0.0.4\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n");
+            socket->write(body);
+            socket->disconnectFromHost();
+        });
+    });
+
+    QTimer timer;
+    connect(&timer, &QTimer::timeout, [this](){
+        if(!writeFile()){
+            qWarning("Failed to write the metrics to %s", qPrintable(path));
+        }
+    });
+    if(!path.isEmpty()){
+        timer.start(interval * 1000);
+    }
+    exec();
+}
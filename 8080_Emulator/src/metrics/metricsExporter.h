@@ -0,0 +1,41 @@
+/**************************************************************************************************
+    ** File Name: metricsExporter.h
+    ** Description: This file contains the Class declaration for the MetricsExporter class, the
+        thread that hands the Metrics to fleet monitoring. It can answer HTTP scrapes on a local
+        port, write a Prometheus textfile every few seconds, or both, so none of the socket or
+        disk work happens on the emulation thread.
+**************************************************************************************************/
+#include <QString>
+#include <QThread>
+
+#include "metrics.h"
+
+#ifndef METRICSEXPORTER_H
+#define METRICSEXPORTER_H
+
+
+class MetricsExporter : public QThread
+{
+    Q_OBJECT
+public:
+    MetricsExporter();                          //default constructor
+    ~MetricsExporter();                         //destructor
+
+    bool isEnabled();                           //checks if a port or a file was asked for
+    void stop();                                //ends the thread, writing the file a last time
+
+private:
+    void run();                                 //listens and writes until stopped
+    QByteArray exposition();                    //the metrics with the clock rate since last time
+    bool writeFile();
+
+    int port;                                   //local port scrapes are served on, 0 for none
+    QString path;                               //textfile written every interval, empty for none
+    int interval;                               //seconds between writes of the textfile
+
+    //where the cycles counter was at the last export, for the emulated clock rate
+    uint64_t lastCycles;
+    int64_t lastTime;
+};
+
+#endif // METRICSEXPORTER_H
@@ -0,0 +1,196 @@
+/**************************************************************************************************
+    ** File Name: options.cpp
+    ** Description: This file contains the member function definitions for the Options class.
+**************************************************************************************************/
+#include <QCommandLineParser>
+#include <QDir>
+
+#include "options.h"
+#include "../machine/machine.h"
+
+
+/**************************************************************************************************
+    ** Function Name: Options::Options()
+    ** Description: The default constructor for the Options class, sets every option to the
+        value used when nothing is given on the command line.
+**************************************************************************************************/
+Options::Options()
+{
+    blockCache = false;
+    jit = false;
+    jitVerify = false;
+    verifyHandlers = false;
+    strictTiming = false;
+    renderHalves = false;
+    renderLines = 0;
+    synthSound = false;
+    audioSync = false;
+    turbo = false;
+    metricsPort = 0;
+    metricsInterval = 15;
+    fuzzCases = 0;
+    fuzzSeed = 1;
+    profilePath = "cpu_profile";
+    machine = Machine::standard().name;
+}
+
+//returns the single Options object used by the program
+Options& Options::instance(){
+    static Options options;
+    return options;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Options::parse(const QStringList &arguments)
+    ** Description: Reads the command line arguments and stores the options that were given.
+        Unknown arguments are reported by QCommandLineParser and end the program.
+**************************************************************************************************/
+void Options::parse(const QStringList &arguments){
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Space Invaders Emulator");
+    parser.addHelpOption();
+
+    QCommandLineOption blockCacheOption("block-cache",
+        "Run the 8080 a basic block at a time from pre-decoded instructions, instead of decoding each one from memory.");
+    QCommandLineOption jitOption("jit", "Translate hot 8080 blocks into native x86-64 code.");
+    QCommandLineOption jitVerifyOption("jit-verify",
+        "Run every native block in lockstep with the interpreter and stop using the JIT on any mismatch.");
+    QCommandLineOption traceOption("trace",
+        "Record the Cpu state before every instruction to <file>.", "file");
+    QCommandLineOption traceDiffOption("trace-diff",
+        "Compare the two trace files given as arguments and report the first difference.");
+    QCommandLineOption verifyHandlersOption("verify-handlers",
+        "Check every specialised opcode handler against the reference decoder before starting.");
+    parser.addOption(blockCacheOption);
+    parser.addOption(jitOption);
+    parser.addOption(jitVerifyOption);
+    parser.addOption(verifyHandlersOption);
+    QCommandLineOption strictTimingOption("strict-timing",
+        "Charge the 8080 data sheet cycles for every instruction, instead of the few older counts kept by default.");
+    parser.addOption(strictTimingOption);
+    QCommandLineOption renderHalvesOption("render-halves",
+        "Paint the top and bottom of the screen as the emulated beam finishes each, instead of all at once.");
+    parser.addOption(renderHalvesOption);
+    QCommandLineOption renderLinesOption("render-lines",
+        "Paint the screen <lines> lines at a time as the emulated beam passes them, spreading the work over the frame.",
+        "lines");
+    parser.addOption(renderLinesOption);
+    QCommandLineOption synthSoundOption("synth-sound",
+        "Synthesise the cabinet's sounds from the sound port bits instead of playing the recorded samples.");
+    parser.addOption(synthSoundOption);
+    QCommandLineOption audioSyncOption("audio-sync",
+        "Pace the emulation from the audio output's clock instead of the system timer, sleeping between half frames.");
+    parser.addOption(audioSyncOption);
+    QCommandLineOption turboOption("turbo",
+        "Run as fast as possible with the sound off, showing frames no faster than the cabinet's screen. Tab does the same while held.");
+    parser.addOption(turboOption);
+    QCommandLineOption latencyLogOption("latency-log",
+        "Save the times of every key press on its way to the screen to <file> as csv when the emulator exits.",
+        "file");
+    parser.addOption(latencyLogOption);
+    QCommandLineOption machineOption("machine",
+        QString("Emulate the board <name>, one of %1.").arg(Machine::names().join(", ")), "name", machine);
+    parser.addOption(machineOption);
+    QCommandLineOption romPathOption("rom-path",
+        QString("Look for the roms in <dirs>, separated by '%1', before ../roms, roms and the program's roms folder.")
+            .arg(QDir::listSeparator()),
+        "dirs");
+    parser.addOption(romPathOption);
+    QCommandLineOption metricsPortOption("metrics-port",
+        "Serve the runtime metrics in the Prometheus format over HTTP on localhost:<port>.", "port");
+    QCommandLineOption metricsFileOption("metrics-file",
+        "Write the runtime metrics in the Prometheus textfile format to <file> every --metrics-interval seconds.",
+        "file");
+    QCommandLineOption metricsIntervalOption("metrics-interval",
+        "Seconds between writes of the --metrics-file.", "seconds", QString::number(metricsInterval));
+    parser.addOption(metricsPortOption);
+    parser.addOption(metricsFileOption);
+    parser.addOption(metricsIntervalOption);
+    parser.addOption(traceOption);
+    parser.addOption(traceDiffOption);
+    QCommandLineOption fuzzOption("fuzz",
+        "Run <cases> random instructions on every Cpu engine and on a reference 8080 and report any difference."
+        " Exits with 1 if an engine differs from the single-step decoder.",
+        "cases");
+    QCommandLineOption fuzzSeedOption("fuzz-seed", "Seed the --fuzz cases are made from.", "seed", "1");
+    parser.addOption(fuzzOption);
+    parser.addOption(fuzzSeedOption);
+    QCommandLineOption benchmarkOption("benchmark",
+        "Time the opcode handlers, frames, rendering, snapshots and startup and write JSON to <file>, or - for stdout.",
+        "file");
+    parser.addOption(benchmarkOption);
+    QCommandLineOption cpmTestOption("cpm-test",
+        "Run the CP/M .COM programs given as arguments, such as the 8080 diagnostics, and report pass or fail.");
+    parser.addOption(cpmTestOption);
+    parser.addPositionalArgument("files",
+        "With --trace-diff, the two trace files to compare. With --cpm-test, the programs to run.",
+        "[files...]");
+#ifdef CPU_PROFILING
+    QCommandLineOption profileOption("profile",
+        "Write the Cpu profile to <path>.txt and <path>.folded.", "path", profilePath);
+    parser.addOption(profileOption);
+#endif
+
+    parser.process(arguments);
+
+    blockCache = parser.isSet(blockCacheOption);
+    jit = parser.isSet(jitOption) || parser.isSet(jitVerifyOption);
+    jitVerify = parser.isSet(jitVerifyOption);
+    verifyHandlers = parser.isSet(verifyHandlersOption);
+    strictTiming = parser.isSet(strictTimingOption);
+    renderHalves = parser.isSet(renderHalvesOption);
+    synthSound = parser.isSet(synthSoundOption);
+    audioSync = parser.isSet(audioSyncOption);
+    turbo = parser.isSet(turboOption);
+    if(parser.isSet(renderLinesOption)){
+        renderLines = parser.value(renderLinesOption).toInt();
+        if(renderLines <= 0 || renderLines > 224){
+            qFatal("--render-lines needs a number of lines from 1 to 224");
+        }
+    }
+    tracePath = parser.value(traceOption);
+    latencyLogPath = parser.value(latencyLogOption);
+    machine = parser.value(machineOption);
+    if(Machine::find(machine) == nullptr){
+        qFatal("Unknown --machine %s, pick one of %s", qPrintable(machine),
+               qPrintable(Machine::names().join(", ")));
+    }
+    if(parser.isSet(romPathOption)){
+        romPath = parser.value(romPathOption).split(QDir::listSeparator(), QString::SkipEmptyParts);
+    }
+    if(parser.isSet(metricsPortOption)){
+        metricsPort = parser.value(metricsPortOption).toInt();
+        if(metricsPort <= 0 || metricsPort > 65535){
+            qFatal("--metrics-port needs a port from 1 to 65535");
+        }
+    }
+    metricsPath = parser.value(metricsFileOption);
+    metricsInterval = parser.value(metricsIntervalOption).toInt();
+    if(metricsInterval <= 0){
+        qFatal("--metrics-interval needs a number of seconds");
+    }
+    if(parser.isSet(traceDiffOption)){
+        traceDiff = parser.positionalArguments();
+        if(traceDiff.size() != 2){
+            qFatal("--trace-diff needs the two trace files to compare");
+        }
+    }
+    if(parser.isSet(fuzzOption)){
+        fuzzCases = parser.value(fuzzOption).toInt();
+        if(fuzzCases <= 0){
+            qFatal("--fuzz needs the number of cases to run");
+        }
+    }
+    fuzzSeed = parser.value(fuzzSeedOption).toUInt();
+    benchmarkPath = parser.value(benchmarkOption);
+    if(parser.isSet(cpmTestOption)){
+        cpmPrograms = parser.positionalArguments();
+        if(cpmPrograms.isEmpty()){
+            qFatal("--cpm-test needs at least one program to run");
+        }
+    }
+#ifdef CPU_PROFILING
+    profilePath = parser.value(profileOption);
+#endif
+}
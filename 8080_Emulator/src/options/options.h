@@ -0,0 +1,47 @@
+/**************************************************************************************************
+    ** File Name: options.h
+    ** Description: This file contains the Class declaration for the Options class, which holds
+        the settings the emulator was started with. The options are parsed once from the command
+        line in main and read by the other classes when they set themselves up.
+**************************************************************************************************/
+#include <QStringList>
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+
+class Options
+{
+public:
+    static Options& instance();                 //the options shared by the whole program
+    void parse(const QStringList &arguments);   //fills in the options from the command line
+
+    bool blockCache;                            //run basic blocks from the pre-decoded block cache
+    bool jit;                                   //translate hot blocks into native code
+    bool jitVerify;                             //check every native block against the interpreter
+    bool verifyHandlers;                        //check the specialised opcode handlers at startup
+    bool strictTiming;                          //charge data sheet cycles, see cycles.h
+    bool renderHalves;                          //paint each half of the screen as the beam passes it
+    int renderLines;                            //paint this many lines at a time as the beam passes
+    bool synthSound;                            //synthesise the sounds instead of playing samples
+    bool audioSync;                             //pace the emulation from the audio clock
+    bool turbo;                                 //run as fast as possible, showing some frames
+    QString profilePath;                        //where profiler reports go, without an extension
+    QString tracePath;                          //file an execution trace is recorded to, if any
+    QString machine;                            //MAME name of the board to emulate, see machine.h
+    QStringList romPath;                        //directories searched for the rom before the defaults
+    QString latencyLogPath;                     //file every key press's latency is saved to, if any
+    int metricsPort;                            //local port metrics are served on, 0 for none
+    QString metricsPath;                        //Prometheus textfile the metrics are written to
+    int metricsInterval;                        //seconds between writes of metricsPath
+    QStringList traceDiff;                      //two traces to compare instead of running the game
+    QStringList cpmPrograms;                    //CP/M diagnostics to run instead of the game
+    int fuzzCases;                              //cases to fuzz the Cpu with instead of the game
+    uint fuzzSeed;                              //seed the fuzz cases are made from
+    QString benchmarkPath;                      //where benchmark results go, empty to run the game
+
+private:
+    Options();                                  //default constructor
+};
+
+#endif // OPTIONS_H
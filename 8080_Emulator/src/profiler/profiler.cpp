@@ -0,0 +1,299 @@
+/**************************************************************************************************
+    ** File Name: profiler.cpp
+    ** Description: Contains the member function definitions for the Profiler class.
+**************************************************************************************************/
+#include <QFile>
+#include <QPair>
+#include <QTextStream>
+#include <algorithm>
+#include <string.h>
+
+#include "profiler.h"
+
+const int REPORT_TOP_ADDRESSES = 64;            //addresses listed in the flat report
+const double REPORT_MIN_SHARE = 0.001;          //call tree nodes smaller than this are left out
+
+
+/**************************************************************************************************
+    ** Function Name: Profiler::Profiler()
+    ** Description: The default constructor for the Profiler class, allocates the per address
+        counters and starts the call tree with a root node for code outside of any call. memory
+        must be pointed at the Cpu's memory before anything is folded.
+**************************************************************************************************/
+Profiler::Profiler()
+{
+    addresses = new Counter[0x10000];
+    recent = new uint64_t[0x10000];
+    memory = nullptr;
+    reset();
+}
+
+
+/**************************************************************************************************
+    ** Function Name: Profiler::~Profiler()
+    ** Description: Destructor for the Profiler class, frees the per address counters.
+**************************************************************************************************/
+Profiler::~Profiler(){
+    delete[] addresses;
+    delete[] recent;
+}
+
+//clears every counter and drops the call tree back to its root
+void Profiler::reset(){
+    memset(opcodes, 0, sizeof(opcodes));
+    memset(interrupts, 0, sizeof(interrupts));
+    memset(addresses, 0, sizeof(Counter) * 0x10000);
+    memset(recent, 0, sizeof(uint64_t) * 0x10000);
+
+    CallNode root = {0, -1, -1, -1, 0, 0};
+    nodes.clear();
+    nodes.reserve(1024);
+    nodes.append(root);
+    frames.clear();
+    currentNode = 0;
+    pendingCycles = 0;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Profiler::fold()
+    ** Description: Adds the 32 bit counts gathered since the last fold into the 64 bit per
+        address totals and, using the opcode now in memory at each address, into the per opcode
+        totals. Code that was rewritten since the last fold is counted as the opcode that is
+        there now.
+**************************************************************************************************/
+void Profiler::fold(){
+    settleCycles();
+    for(int address = 0; address < 0x10000; ++address){
+        if(recent[address] == 0){
+            continue;
+        }
+        uint32_t count = recent[address] >> 32;
+        uint32_t cycles = (uint32_t)recent[address];
+        addresses[address].count += count;
+        addresses[address].cycles += cycles;
+        opcodes[memory[address]].count += count;
+        opcodes[memory[address]].cycles += cycles;
+        recent[address] = 0;
+    }
+}
+
+//counts an interrupt by its rst, called once the rst has entered the handler so its cycles go
+//to the handler rather than to the code that was interrupted
+void Profiler::recordInterrupt(uint8_t opcode, int cycles){
+    Counter &counter = interrupts[(opcode >> 3) & 7];
+    counter.count++;
+    counter.cycles += cycles;
+    pendingCycles += cycles;
+}
+
+//gives the current function the cycles run since the last call, return or fold, record only
+//adds to a single counter so it does not have to find the current node on every instruction
+void Profiler::settleCycles(){
+    nodes[currentNode].selfCycles += pendingCycles;
+    pendingCycles = 0;
+}
+
+//returns the child of parent that was called at address, or -1 if it has not been called yet
+int Profiler::findChild(int parent, uint16_t address){
+    for(int child = nodes[parent].firstChild; child != -1; child = nodes[child].nextSibling){
+        if(nodes[child].address == address){
+            return child;
+        }
+    }
+    return -1;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Profiler::enterCall(uint16_t target, uint16_t sp)
+    ** Description: Moves into the function at target, adding it to the call tree under the
+        current function the first time this path is seen. Calls past PROFILER_MAX_DEPTH, or
+        new paths once the tree is full, are counted in the current function instead.
+**************************************************************************************************/
+void Profiler::enterCall(uint16_t target, uint16_t sp){
+    settleCycles();
+    if(frames.size() >= PROFILER_MAX_DEPTH){
+        return;
+    }
+    int child = findChild(currentNode, target);
+    if(child == -1){
+        if(nodes.size() >= PROFILER_MAX_NODES){
+            return;
+        }
+        CallNode node = {target, currentNode, -1, nodes[currentNode].firstChild, 0, 0};
+        child = nodes.size();
+        nodes.append(node);
+        nodes[currentNode].firstChild = child;
+    }
+    nodes[child].calls++;
+
+    Frame frame = {currentNode, sp};
+    frames.append(frame);
+    currentNode = child;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void Profiler::leaveCall(uint16_t sp)
+    ** Description: Goes back to the caller of every frame the return popped. Programs sometimes
+        drop a return address instead of returning through it, so frames are unwound by the
+        stack pointer rather than one per RET, which keeps the tree in step with the real stack.
+**************************************************************************************************/
+void Profiler::leaveCall(uint16_t sp){
+    settleCycles();
+    while(!frames.isEmpty() && frames.last().sp < sp){
+        currentNode = frames.last().node;
+        frames.removeLast();
+    }
+}
+
+//adds up the cycles of node and everything it called, storing each node's total in totals
+uint64_t Profiler::inclusiveCycles(int node, QVector<uint64_t> &totals){
+    uint64_t total = nodes[node].selfCycles;
+    for(int child = nodes[node].firstChild; child != -1; child = nodes[child].nextSibling){
+        total += inclusiveCycles(child, totals);
+    }
+    totals[node] = total;
+    return total;
+}
+
+//returns the semicolon separated list of functions from the root down to node
+QString Profiler::callPath(int node){
+    QString path;
+    for(; node > 0; node = nodes[node].parent){
+        path.prepend(QString(";0x%1").arg(nodes[node].address, 4, 16, QChar('0')));
+    }
+    return "root" + path;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool Profiler::writeReport(const QString &path)
+    ** Description: Writes a flat text report to path: every executed opcode sorted by cycles, the
+        interrupts taken, the REPORT_TOP_ADDRESSES hottest addresses, and the call tree with the
+        inclusive and self cycles of each function, indented by call depth. Returns false if the
+        file cannot be opened.
+**************************************************************************************************/
+bool Profiler::writeReport(const QString &path){
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)){
+        return false;
+    }
+    QTextStream out(&file);
+    fold();
+
+    uint64_t totalCount = 0;
+    uint64_t totalCycles = 0;
+    for(int opcode = 0; opcode < 256; ++opcode){
+        totalCount += opcodes[opcode].count;
+        totalCycles += opcodes[opcode].cycles;
+    }
+    for(int rst = 0; rst < 8; ++rst){
+        totalCycles += interrupts[rst].cycles;
+    }
+    double cycleScale = totalCycles ? 100.0 / totalCycles : 0.0;
+    out << "Cpu profile: " << totalCount << " instructions, " << totalCycles << " cycles\n\n";
+
+    //opcodes, hottest first
+    QVector<int> order;
+    for(int opcode = 0; opcode < 256; ++opcode){
+        if(opcodes[opcode].count != 0){
+            order.append(opcode);
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b){
+        return opcodes[a].cycles > opcodes[b].cycles;
+    });
+    out << "Opcodes by cycles\n";
+    out << "opcode      executions          cycles   share\n";
+    for(int opcode : order){
+        out << QString("  0x%1  %2  %3  %4%\n")
+               .arg(opcode, 2, 16, QChar('0'))
+               .arg(opcodes[opcode].count, 14)
+               .arg(opcodes[opcode].cycles, 14)
+               .arg(opcodes[opcode].cycles * cycleScale, 5, 'f', 1);
+    }
+
+    //interrupts, which are not in the opcode or address counts
+    out << "\nInterrupts\n";
+    out << "rst              taken          cycles   share\n";
+    for(int rst = 0; rst < 8; ++rst){
+        if(interrupts[rst].count != 0){
+            out << QString("  rst %1 %2  %3  %4%\n")
+                   .arg(rst)
+                   .arg(interrupts[rst].count, 14)
+                   .arg(interrupts[rst].cycles, 14)
+                   .arg(interrupts[rst].cycles * cycleScale, 5, 'f', 1);
+        }
+    }
+
+    //addresses, hottest first
+    QVector<int> hottest;
+    for(int address = 0; address < 0x10000; ++address){
+        if(addresses[address].count != 0){
+            hottest.append(address);
+        }
+    }
+    std::sort(hottest.begin(), hottest.end(), [this](int a, int b){
+        return addresses[a].cycles > addresses[b].cycles;
+    });
+    out << "\nHottest addresses by cycles\n";
+    out << "address     executions          cycles   share\n";
+    for(int i = 0; i < hottest.size() && i < REPORT_TOP_ADDRESSES; ++i){
+        int address = hottest[i];
+        out << QString(" 0x%1  %2  %3  %4%\n")
+               .arg(address, 4, 16, QChar('0'))
+               .arg(addresses[address].count, 14)
+               .arg(addresses[address].cycles, 14)
+               .arg(addresses[address].cycles * cycleScale, 5, 'f', 1);
+    }
+
+    //call tree, walked depth first with an explicit stack of (node, depth)
+    QVector<uint64_t> totals(nodes.size());
+    inclusiveCycles(0, totals);
+    out << "\nCall tree (inclusive cycles, self cycles, calls)\n";
+    QVector<QPair<int, int> > pending;
+    pending.append(qMakePair(0, 0));
+    while(!pending.isEmpty()){
+        int node = pending.last().first;
+        int depth = pending.last().second;
+        pending.removeLast();
+        if(node != 0 && totals[node] < totalCycles * REPORT_MIN_SHARE){
+            continue;
+        }
+        QString name = node == 0 ? QString("root")
+                                 : QString("0x%1").arg(nodes[node].address, 4, 16, QChar('0'));
+        out << QString(depth * 2, ' ') << name
+            << QString("  %1% %2% %3\n")
+               .arg(totals[node] * cycleScale, 0, 'f', 1)
+               .arg(nodes[node].selfCycles * cycleScale, 0, 'f', 1)
+               .arg(nodes[node].calls);
+        for(int child = nodes[node].firstChild; child != -1; child = nodes[child].nextSibling){
+            pending.append(qMakePair(child, depth + 1));
+        }
+    }
+    return true;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool Profiler::writeFoldedStacks(const QString &path)
+    ** Description: Writes the call tree to path in the folded stack format read by flamegraph.pl
+        and speedscope, one "root;0x0ADD;0x1A5F cycles" line for every call path that spent
+        cycles of its own. Returns false if the file cannot be opened.
+**************************************************************************************************/
+bool Profiler::writeFoldedStacks(const QString &path){
+    QFile file(path);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text)){
+        return false;
+    }
+    QTextStream out(&file);
+    settleCycles();
+    for(int node = 0; node < nodes.size(); ++node){
+        if(nodes[node].selfCycles != 0){
+            out << callPath(node) << ' ' << nodes[node].selfCycles << '\n';
+        }
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+/**************************************************************************************************
+    ** File Name: profiler.h
+    ** Description: This file contains the Class declaration for the Profiler class, which counts
+        how often each opcode and each address is executed and how many cycles they take. CALL
+        and RET pairs are followed to build a call tree, so the report can show where time goes
+        by function as well as by instruction. The Cpu only records into a Profiler when the
+        emulator is built with CPU_PROFILING defined (qmake CONFIG+=cpu_profiling).
+
+        To keep the cost per instruction low the address that ran gets a single 64 bit add, its
+        count in the top 32 bits and its cycles in the bottom 32. These are folded into 64 bit
+        totals, and into per opcode totals using the byte at each address, whenever a report is
+        written or fold is called, which the Emulator does often enough that the cycles cannot
+        carry into the count.
+        Interrupts are counted by their rst on their own, as the rst was not fetched from the
+        address that was interrupted.
+**************************************************************************************************/
+#include <QString>
+#include <QVector>
+#include <stdint.h>
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+const int PROFILER_MAX_DEPTH = 256;             //calls nested deeper than this stay in their caller
+const int PROFILER_MAX_NODES = 0x10000;         //call tree size before new paths stop being added
+
+class Profiler
+{
+public:
+    Profiler();                                 //default constructor
+    ~Profiler();                                //destructor
+
+    //how often something was executed and the cycles it took
+    struct Counter{
+        uint64_t count;
+        uint64_t cycles;
+    };
+
+    //counts one instruction, kept inline as it runs before every opcode
+    void record(uint16_t pc, int cycles){
+        recent[pc] += RECENT_COUNT_ONE | cycles;
+        pendingCycles += cycles;
+    }
+
+    //adds cycles to the instruction at pc without counting it again, for a conditional call
+    //or return that was taken after record counted it at its not taken cost
+    void recordExtraCycles(uint16_t pc, int cycles){
+        recent[pc] += cycles;
+        pendingCycles += cycles;
+    }
+
+    void recordInterrupt(uint8_t opcode, int cycles);
+    void fold();                                    //adds the recent counts into the totals
+    void enterCall(uint16_t target, uint16_t sp);   //a call or interrupt pushed a return address
+    void leaveCall(uint16_t sp);                    //a return popped one
+    void reset();                                   //clears every count and the call tree
+
+    bool writeReport(const QString &path);          //flat text report
+    bool writeFoldedStacks(const QString &path);    //one line per call path, for flamegraph.pl
+
+    Counter opcodes[256];                       //totals as of the last fold
+    Counter interrupts[8];                      //interrupts taken, by rst number
+    Counter *addresses;                         //one per address in the 64K space, as of the last fold
+    const uint8_t *memory;                      //the Cpu's memory, read to find each address's opcode
+
+private:
+    //a function in the call tree, reached through the path of calls from the root
+    struct CallNode{
+        uint16_t address;                       //address that was called
+        int parent;
+        int firstChild;
+        int nextSibling;
+        uint64_t selfCycles;                    //cycles spent in this function but not its callees
+        uint64_t calls;
+    };
+
+    //a call that has not returned yet, sp is the stack pointer just after the call
+    struct Frame{
+        int node;
+        uint16_t sp;
+    };
+
+    static const uint64_t RECENT_COUNT_ONE = (uint64_t)1 << 32;
+    uint64_t *recent;                           //per address count and cycles since the last fold
+
+    QVector<CallNode> nodes;
+    QVector<Frame> frames;
+    int currentNode;
+    uint64_t pendingCycles;                     //cycles not yet added to currentNode's selfCycles
+
+    void settleCycles();
+    int findChild(int parent, uint16_t address);
+    uint64_t inclusiveCycles(int node, QVector<uint64_t> &totals);
+    QString callPath(int node);
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,303 @@
+/**************************************************************************************************
+    ** File Name: romLoader.cpp
+    ** Description: Contains the member function definitions for the RomLoader class.
+**************************************************************************************************/
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QResource>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <string.h>
+
+#include "romLoader.h"
+#include "../options/options.h"
+
+
+/**************************************************************************************************
+    ** Function Name: bool RomLoader::load(const Machine &machine, uint8_t *memory,
+        uint8_t *colourProm)
+    ** Description: Copies the first good copy of the board's roms into memory, and its colour
+        proms into colourProm. The embedded image is tried first when the program was built
+        with it, then the board's image in every directory of searchPath in order and the copy
+        in the cache. After those the MAME set is assembled from the first directory, or board
+        named subdirectory, holding all of its files, and saved to the cache. Files that are
+        the wrong size or fail a checksum are reported and skipped. Returns false if no good
+        copy was found.
+**************************************************************************************************/
+bool RomLoader::load(const Machine &machine, uint8_t *memory, uint8_t *colourProm){
+    QStringList directories = searchPath();
+    if(machine.image != nullptr){
+#ifdef EMBEDDED_ROM
+        if(loadEmbedded(machine, memory)){
+            return true;
+        }
+#endif
+        for(const QString &directory : directories){
+            if(loadFile(machine, QDir(directory).filePath(machine.image), memory)){
+                return true;
+            }
+        }
+        QString cache = cachePath(machine);
+        if(!cache.isEmpty() && loadFile(machine, cache, memory)){
+            return true;
+        }
+    }
+    for(const QString &directory : directories){
+        if(loadSet(machine, directory, memory, colourProm)
+                || loadSet(machine, QDir(directory).filePath(machine.name), memory, colourProm)){
+            saveCache(machine, memory);
+            return true;
+        }
+    }
+    qWarning("No good roms for %s were found in: %s", machine.name,
+             qPrintable(QDir::toNativeSeparators(directories.join(", "))));
+    return false;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: QStringList RomLoader::searchPath()
+    ** Description: Returns the directories the roms are looked for in: those given with
+        --rom-path first, then ../roms and roms under the working directory, which is where the
+        roms sit when the emulator is run from the build or source folder, and last roms next
+        to the program itself.
+**************************************************************************************************/
+QStringList RomLoader::searchPath(){
+    QStringList directories = Options::instance().romPath;
+    directories << "../roms" << "roms";
+    if(QCoreApplication::instance() != nullptr){
+        directories << QDir(QCoreApplication::applicationDirPath()).filePath("roms");
+    }
+    return directories;
+}
+
+//returns the file the board's assembled image is cached in, empty if it has no single image or
+//the system has no cache folder
+QString RomLoader::cachePath(const Machine &machine){
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if(machine.image == nullptr || directory.isEmpty()){
+        return QString();
+    }
+    return QDir(directory).filePath(machine.image);
+}
+
+
+/**************************************************************************************************
+    ** Function Name: uint32_t RomLoader::crc32(const uint8_t *data, qint64 size)
+    ** Description: Returns the CRC-32 of size bytes of data, the same checksum zip files and
+        MAME's rom lists use. The table is built on the first call.
+**************************************************************************************************/
+uint32_t RomLoader::crc32(const uint8_t *data, qint64 size){
+    static uint32_t table[256];
+    static bool tableBuilt = false;
+    if(!tableBuilt){
+        for(uint32_t i = 0; i < 256; ++i){
+            uint32_t crc = i;
+            for(int bit = 0; bit < 8; ++bit){
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        tableBuilt = true;
+    }
+
+    uint32_t crc = 0xFFFFFFFF;
+    for(qint64 i = 0; i < size; ++i){
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool RomLoader::loadEmbedded(const Machine &machine, uint8_t *memory)
+    ** Description: Copies the board's image compiled into the program by "qmake
+        CONFIG+=embed_rom". That build runs rcc with -no-compress, so the resource points
+        straight at the program's read only data and nothing is read from disk or unpacked.
+**************************************************************************************************/
+bool RomLoader::loadEmbedded(const Machine &machine, uint8_t *memory){
+    QResource resource(QDir(EMBEDDED_ROM_DIRECTORY).filePath(machine.image));
+    if(!resource.isValid()){
+        return false;
+    }
+    const uint8_t *data = resource.data();
+    qint64 size = resource.size();
+    if(!check(machine, data, size, "the embedded rom")){
+        return false;
+    }
+    placeImage(machine, data, memory);
+    return true;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool RomLoader::loadFile(const Machine &machine, const QString &path,
+        uint8_t *memory)
+    ** Description: Copies the board's image at path into memory. The file is mapped read only,
+        which shares its pages with every other emulator that has it mapped and skips the copy
+        through a read buffer; the Cpu's memory is writable so the roms are still copied out of
+        the mapping. Files that cannot be mapped are read instead. Returns false if the file is
+        missing or bad.
+**************************************************************************************************/
+bool RomLoader::loadFile(const Machine &machine, const QString &path, uint8_t *memory){
+    QFile file(path);
+    if(!file.exists() || !file.open(QIODevice::ReadOnly)){
+        return false;
+    }
+
+    QByteArray contents;
+    qint64 size = file.size();
+    const uint8_t *data = file.map(0, size);
+    if(data == nullptr){
+        contents = file.readAll();
+        data = reinterpret_cast<const uint8_t*>(contents.constData());
+        size = contents.size();
+    }
+    bool good = check(machine, data, size, path);
+    if(good){
+        placeImage(machine, data, memory);
+    }
+    file.close();                               //unmaps the file
+    return good;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool RomLoader::loadSet(const Machine &machine, const QString &directory,
+        uint8_t *memory, uint8_t *colourProm)
+    ** Description: Assembles the board's MAME set in directory, each program rom at its place
+        in memory and each colour prom at its place in colourProm. Every file is checked before
+        anything is copied, so a bad set leaves both as they were. Returns false quietly if the
+        directory has none of the files, and with a warning if some are missing or bad.
+**************************************************************************************************/
+bool RomLoader::loadSet(const Machine &machine, const QString &directory, uint8_t *memory,
+                        uint8_t *colourProm){
+    QDir dir(directory);
+    int found = 0;
+    for(int i = 0; i < machine.romCount; ++i){
+        if(QFile::exists(dir.filePath(machine.roms[i].fileName))){
+            found++;
+        }
+    }
+    if(found == 0){
+        return false;
+    }
+    if(found < machine.romCount){
+        qWarning("Skipping the %s set in %s, only %d of its %d files are there", machine.name,
+                 qPrintable(QDir::toNativeSeparators(directory)), found, machine.romCount);
+        return false;
+    }
+
+    QByteArray contents[MACHINE_MAX_ROMS];
+    for(int i = 0; i < machine.romCount; ++i){
+        QFile file(dir.filePath(machine.roms[i].fileName));
+        if(!file.open(QIODevice::ReadOnly)){
+            qWarning("Skipping the %s set, %s cannot be read", machine.name,
+                     qPrintable(file.fileName()));
+            return false;
+        }
+        contents[i] = file.readAll();
+        if(!checkPart(machine.roms[i], contents[i], file.fileName())){
+            return false;
+        }
+    }
+    for(int i = 0; i < machine.romCount; ++i){
+        const MachineRom &rom = machine.roms[i];
+        uint8_t *destination = rom.colourProm ? colourProm : memory;
+        memcpy(destination + rom.address, contents[i].constData(), rom.size);
+    }
+    return true;
+}
+
+//copies a joined image, the board's program roms one after another, to their places in memory
+void RomLoader::placeImage(const Machine &machine, const uint8_t *image, uint8_t *memory){
+    for(int i = 0; i < machine.romCount; ++i){
+        const MachineRom &rom = machine.roms[i];
+        if(!rom.colourProm){
+            memcpy(memory + rom.address, image, rom.size);
+            image += rom.size;
+        }
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void RomLoader::saveCache(const Machine &machine, const uint8_t *memory)
+    ** Description: Writes the board's program roms, as they are in memory, to cachePath as its
+        joined image, so the next start maps one file instead of assembling the MAME set again.
+        The file is replaced in one step, so another emulator starting at the same time never
+        sees half of it. A cache that cannot be written is only reported, the roms are already
+        loaded.
+**************************************************************************************************/
+void RomLoader::saveCache(const Machine &machine, const uint8_t *memory){
+    QString path = cachePath(machine);
+    if(path.isEmpty() || !QDir().mkpath(QFileInfo(path).absolutePath())){
+        return;
+    }
+    QSaveFile file(path);
+    if(!file.open(QIODevice::WriteOnly)){
+        qWarning("Could not cache the rom in %s", qPrintable(path));
+        return;
+    }
+    for(int i = 0; i < machine.romCount; ++i){
+        const MachineRom &rom = machine.roms[i];
+        if(!rom.colourProm){
+            file.write(reinterpret_cast<const char*>(memory + rom.address), rom.size);
+        }
+    }
+    if(!file.commit()){
+        qWarning("Could not cache the rom in %s", qPrintable(path));
+    }
+}
+
+//returns true if data is the rom file described, warning about source otherwise. Checksums the
+//description does not list are not checked
+bool RomLoader::checkPart(const MachineRom &rom, const QByteArray &data, const QString &source){
+    const uint8_t *bytes = reinterpret_cast<const uint8_t*>(data.constData());
+    if(data.size() != rom.size){
+        qWarning("Skipping the set, %s is %d bytes instead of %d", qPrintable(source),
+                 data.size(), rom.size);
+        return false;
+    }
+    uint32_t crc = crc32(bytes, data.size());
+    if(rom.crc != 0 && crc != rom.crc){
+        qWarning("Skipping the set, the CRC-32 of %s is %08x instead of %08x",
+                 qPrintable(source), crc, rom.crc);
+        return false;
+    }
+    if(rom.sha1 != nullptr && sha1(bytes, data.size()) != rom.sha1){
+        qWarning("Skipping the set, the SHA-1 of %s is wrong", qPrintable(source));
+        return false;
+    }
+    return true;
+}
+
+//returns true if data is the board's whole joined image, warning about source otherwise
+bool RomLoader::check(const Machine &machine, const uint8_t *data, qint64 size,
+                      const QString &source){
+    if(size != machine.imageSize()){
+        qWarning("Skipping %s, it is %lld bytes instead of %d", qPrintable(source),
+                 (long long)size, machine.imageSize());
+        return false;
+    }
+    uint32_t crc = crc32(data, size);
+    if(crc != machine.imageCrc){
+        qWarning("Skipping %s, its CRC-32 is %08x instead of %08x", qPrintable(source), crc,
+                 machine.imageCrc);
+        return false;
+    }
+    if(sha1(data, size) != machine.imageSha1){
+        qWarning("Skipping %s, its SHA-1 is wrong", qPrintable(source));
+        return false;
+    }
+    return true;
+}
+
+//returns the SHA-1 of size bytes of data as lower case hex, the form MAME's rom lists use
+QByteArray RomLoader::sha1(const uint8_t *data, qint64 size){
+    QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(data), int(size));
+    return QCryptographicHash::hash(bytes, QCryptographicHash::Sha1).toHex();
+}
@@ -0,0 +1,48 @@
+/**************************************************************************************************
+    ** File Name: romLoader.h
+    ** Description: This file contains the Class declaration for the RomLoader class, which finds
+        a board's roms and copies them into the Cpu's memory and the colour prom. For a board
+        whose roms also come joined into one image, such as invaders.rom, a copy compiled into
+        the program with "qmake CONFIG+=embed_rom" is used first, then the image is looked for
+        in each directory of the search path and in the cache. Images are memory mapped rather
+        than read, so every running emulator shares the same pages of the file. Failing those,
+        the board's MAME set is assembled from the first directory that has it, or its
+        subdirectory named after the board, and an assembled image is saved to the cache for
+        the next start. Every file is checked against the size, CRC-32 and SHA-1 listed in its
+        Machine before it is used.
+**************************************************************************************************/
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <stdint.h>
+
+#include "../machine/machine.h"
+
+#ifndef ROMLOADER_H
+#define ROMLOADER_H
+
+const char EMBEDDED_ROM_DIRECTORY[] = ":/roms";
+
+class RomLoader
+{
+public:
+    //copies the board's roms into memory and colourProm, false if no good set is found
+    static bool load(const Machine &machine, uint8_t *memory, uint8_t *colourProm);
+    static QStringList searchPath();            //directories the roms are looked for in
+    static QString cachePath(const Machine &machine);   //where an assembled image is saved
+    static uint32_t crc32(const uint8_t *data, qint64 size);
+
+private:
+    static bool loadEmbedded(const Machine &machine, uint8_t *memory);
+    static bool loadFile(const Machine &machine, const QString &path, uint8_t *memory);
+    static bool loadSet(const Machine &machine, const QString &directory, uint8_t *memory,
+                        uint8_t *colourProm);
+    static void placeImage(const Machine &machine, const uint8_t *image, uint8_t *memory);
+    static void saveCache(const Machine &machine, const uint8_t *memory);
+    static bool checkPart(const MachineRom &rom, const QByteArray &data, const QString &source);
+    static bool check(const Machine &machine, const uint8_t *data, qint64 size,
+                      const QString &source);
+    static QByteArray sha1(const uint8_t *data, qint64 size);
+};
+
+#endif // ROMLOADER_H
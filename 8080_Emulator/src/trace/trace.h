@@ -0,0 +1,43 @@
+/**************************************************************************************************
+    ** File Name: trace.h
+    ** Description: Definitions shared by the TraceWriter and TraceReader classes for the binary
+        execution trace format. A trace file starts with TRACE_MAGIC and is followed by chunks,
+        each a 32 bit little endian byte count and a block of qCompress output. Uncompressed, a
+        chunk is a run of records, one per instruction, holding the Cpu state just before the
+        instruction ran. A record is a mask byte and the opcode followed by only the fields the
+        mask says changed since the previous record. The first record of each chunk has every
+        field, so every chunk can be decoded without the ones before it.
+**************************************************************************************************/
+#include <stdint.h>
+
+#ifndef TRACE_H
+#define TRACE_H
+
+const char TRACE_MAGIC[8] = {'8', '0', '8', '0', 'T', 'R', 'C', '1'};
+const int TRACE_CHUNK_SIZE = 0x40000;           //uncompressed bytes gathered before compressing
+const int TRACE_RING_SLOTS = 8;                 //full chunks that can wait for the writer thread
+const int TRACE_MAX_RECORD_SIZE = 14;           //mask, opcode, pc and every register changed
+
+//mask byte, bits 0-1 hold how far the pc moved from the previous record, 0 meaning the whole pc
+//follows, and each other bit marks a field that follows because it changed
+const uint8_t TRACE_PC_STEP = 0x03;
+const uint8_t TRACE_A = 0x04;
+const uint8_t TRACE_FLAGS = 0x08;
+const uint8_t TRACE_BC = 0x10;
+const uint8_t TRACE_DE = 0x20;
+const uint8_t TRACE_HL = 0x40;
+const uint8_t TRACE_SP = 0x80;
+
+//the Cpu state recorded for one instruction
+struct TraceRecord{
+    uint16_t pc;
+    uint16_t sp;
+    uint16_t bc;
+    uint16_t de;
+    uint16_t hl;
+    uint8_t a;
+    uint8_t flags;                              //flag register as built by Flags
+    uint8_t opcode;                             //opcode run, or the rst an interrupt ran
+};
+
+#endif // TRACE_H
@@ -0,0 +1,194 @@
+/**************************************************************************************************
+    ** File Name: traceReader.cpp
+    ** Description: Contains the member function definitions for the TraceReader class.
+**************************************************************************************************/
+#include <QTextStream>
+#include <string.h>
+
+#include "traceReader.h"
+
+
+/**************************************************************************************************
+    ** Function Name: TraceReader::TraceReader()
+    ** Description: The default constructor for the TraceReader class.
+**************************************************************************************************/
+TraceReader::TraceReader()
+{
+    failed = false;
+    chunkPosition = 0;
+    memset(&previous, 0, sizeof(TraceRecord));
+}
+
+//opens the trace at path and checks that it starts with the trace header
+bool TraceReader::open(const QString &path){
+    file.setFileName(path);
+    if(!file.open(QIODevice::ReadOnly)){
+        return false;
+    }
+    QByteArray magic = file.read(sizeof(TRACE_MAGIC));
+    return magic.size() == sizeof(TRACE_MAGIC) && memcmp(magic.constData(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0;
+}
+
+//reads and uncompresses the next chunk, false at the end of the file or if the chunk is damaged
+bool TraceReader::loadChunk(){
+    QByteArray sizeBytes = file.read(4);
+    if(sizeBytes.isEmpty()){
+        return false;
+    }
+    const uint8_t *bytes = (const uint8_t*)sizeBytes.constData();
+    uint32_t size = 0;
+    if(sizeBytes.size() == 4){
+        size = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    }
+    QByteArray compressed = file.read(size);
+    chunk = size ? qUncompress(compressed) : QByteArray();
+    chunkPosition = 0;
+    if(sizeBytes.size() != 4 || compressed.size() != (int)size || chunk.isEmpty()){
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool TraceReader::next(TraceRecord &record)
+    ** Description: Decodes the next record into record, filling in the fields the mask byte
+        leaves out from the record before it. Returns false once the trace is used up, setting
+        failed if that happened partway through a record or chunk.
+**************************************************************************************************/
+bool TraceReader::next(TraceRecord &record){
+    if(chunkPosition >= chunk.size() && !loadChunk()){
+        return false;
+    }
+    const uint8_t *start = (const uint8_t*)chunk.constData();
+    const uint8_t *in = start + chunkPosition;
+    const uint8_t *end = start + chunk.size();
+    if(end - in < 2){
+        failed = true;
+        return false;
+    }
+
+    uint8_t mask = *in++;
+    record = previous;
+    record.opcode = *in++;
+
+    //every field in the mask must fit in what is left of the chunk
+    int needed = ((mask & TRACE_PC_STEP) ? 0 : 2) + ((mask & TRACE_A) ? 1 : 0)
+            + ((mask & TRACE_FLAGS) ? 1 : 0) + ((mask & TRACE_BC) ? 2 : 0)
+            + ((mask & TRACE_DE) ? 2 : 0) + ((mask & TRACE_HL) ? 2 : 0) + ((mask & TRACE_SP) ? 2 : 0);
+    if(end - in < needed){
+        failed = true;
+        return false;
+    }
+
+    if(mask & TRACE_PC_STEP){
+        record.pc = previous.pc + (mask & TRACE_PC_STEP);
+    }
+    else{
+        record.pc = in[0] | (in[1] << 8);
+        in += 2;
+    }
+    if(mask & TRACE_A){
+        record.a = *in++;
+    }
+    if(mask & TRACE_FLAGS){
+        record.flags = *in++;
+    }
+    if(mask & TRACE_BC){
+        record.bc = in[0] | (in[1] << 8);
+        in += 2;
+    }
+    if(mask & TRACE_DE){
+        record.de = in[0] | (in[1] << 8);
+        in += 2;
+    }
+    if(mask & TRACE_HL){
+        record.hl = in[0] | (in[1] << 8);
+        in += 2;
+    }
+    if(mask & TRACE_SP){
+        record.sp = in[0] | (in[1] << 8);
+        in += 2;
+    }
+    chunkPosition = in - start;
+    previous = record;
+    return true;
+}
+
+//compares every field of two records
+static bool sameState(const TraceRecord &a, const TraceRecord &b){
+    return a.pc == b.pc && a.opcode == b.opcode && a.a == b.a && a.flags == b.flags
+            && a.bc == b.bc && a.de == b.de && a.hl == b.hl && a.sp == b.sp;
+}
+
+//formats one record for the diff output
+static QString describe(const TraceRecord &record){
+    return QString("pc=%1 op=%2 a=%3 f=%4 bc=%5 de=%6 hl=%7 sp=%8")
+            .arg(record.pc, 4, 16, QChar('0'))
+            .arg(record.opcode, 2, 16, QChar('0'))
+            .arg(record.a, 2, 16, QChar('0'))
+            .arg(record.flags, 2, 16, QChar('0'))
+            .arg(record.bc, 4, 16, QChar('0'))
+            .arg(record.de, 4, 16, QChar('0'))
+            .arg(record.hl, 4, 16, QChar('0'))
+            .arg(record.sp, 4, 16, QChar('0'));
+}
+
+
+/**************************************************************************************************
+    ** Function Name: int TraceReader::diff(const QString &firstPath, const QString &secondPath)
+    ** Description: Reads two traces in step and prints the first record where they differ,
+        with the record before it for context, or where one of them ends early. A record holds
+        the state before its instruction, so the instruction that caused a divergence is the
+        one in the previous record. Returns 0 if the traces match, 1 if they differ and 2 if
+        either cannot be read, for use as the program's exit code.
+**************************************************************************************************/
+int TraceReader::diff(const QString &firstPath, const QString &secondPath){
+    QTextStream out(stdout);
+    TraceReader first;
+    TraceReader second;
+    if(!first.open(firstPath)){
+        out << "Could not read " << firstPath << " as a trace\n";
+        return 2;
+    }
+    if(!second.open(secondPath)){
+        out << "Could not read " << secondPath << " as a trace\n";
+        return 2;
+    }
+
+    TraceRecord a;
+    TraceRecord b;
+    TraceRecord before;
+    memset(&before, 0, sizeof(TraceRecord));
+    uint64_t index = 0;
+    while(true){
+        bool haveFirst = first.next(a);
+        bool haveSecond = second.next(b);
+        if(first.failed || second.failed){
+            out << "Trace " << (first.failed ? firstPath : secondPath)
+                << " is damaged after " << index << " instructions\n";
+            return 2;
+        }
+        if(!haveFirst && !haveSecond){
+            out << "Traces match for all " << index << " instructions\n";
+            return 0;
+        }
+        if(haveFirst != haveSecond){
+            out << "Trace " << (haveFirst ? secondPath : firstPath) << " ends after "
+                << index << " instructions\n";
+            return 1;
+        }
+        if(!sameState(a, b)){
+            out << "Traces diverge at instruction " << index << "\n";
+            if(index > 0){
+                out << "  last common: " << describe(before) << "\n";
+            }
+            out << "  " << firstPath << ": " << describe(a) << "\n";
+            out << "  " << secondPath << ": " << describe(b) << "\n";
+            return 1;
+        }
+        before = a;
+        index++;
+    }
+}
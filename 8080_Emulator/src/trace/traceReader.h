@@ -0,0 +1,36 @@
+/**************************************************************************************************
+    ** File Name: traceReader.h
+    ** Description: This file contains the Class declaration for the TraceReader class, which
+        reads back the execution traces written by TraceWriter one record at a time, and the diff
+        tool that walks two traces side by side to find the first instruction where they differ.
+**************************************************************************************************/
+#include <QByteArray>
+#include <QFile>
+
+#include "trace.h"
+
+#ifndef TRACEREADER_H
+#define TRACEREADER_H
+
+
+class TraceReader
+{
+public:
+    TraceReader();                              //default constructor
+
+    bool open(const QString &path);             //checks the header, false if it is not a trace
+    bool next(TraceRecord &record);             //reads the next record, false at the end
+    bool failed;                                //set if the file ended inside a chunk or was corrupt
+
+    static int diff(const QString &firstPath, const QString &secondPath);
+
+private:
+    bool loadChunk();
+
+    QFile file;
+    QByteArray chunk;                           //uncompressed records of the current chunk
+    int chunkPosition;
+    TraceRecord previous;
+};
+
+#endif // TRACEREADER_H
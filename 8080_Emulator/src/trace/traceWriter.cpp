@@ -0,0 +1,220 @@
+/**************************************************************************************************
+    ** File Name: traceWriter.cpp
+    ** Description: Contains the member function definitions for the TraceWriter class.
+**************************************************************************************************/
+#include <QDebug>
+
+#include "traceWriter.h"
+
+const int TRACE_COMPRESSION_LEVEL = 1;          //favours speed, the deltas already compress well
+
+
+/**************************************************************************************************
+    ** Function Name: TraceWriter::TraceWriter()
+    ** Description: The default constructor for the TraceWriter class, allocates the chunk the
+        emulation thread encodes into. Nothing is recorded until open succeeds.
+**************************************************************************************************/
+TraceWriter::TraceWriter()
+{
+    chunk = new uint8_t[TRACE_CHUNK_SIZE + TRACE_MAX_RECORD_SIZE];
+    chunkUsed = 0;
+    opened = false;
+    ringHead = 0;
+    ringCount = 0;
+    closing = false;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: TraceWriter::~TraceWriter()
+    ** Description: Destructor for the TraceWriter class, finishes the trace if it is still open.
+**************************************************************************************************/
+TraceWriter::~TraceWriter(){
+    close();
+    delete[] chunk;
+}
+
+//checks if a trace is being recorded
+bool TraceWriter::isOpen(){
+    return opened;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: bool TraceWriter::open(const QString &path)
+    ** Description: Creates the trace file at path, writes the header and starts the writer
+        thread. Returns false, leaving tracing off, if the file cannot be created.
+**************************************************************************************************/
+bool TraceWriter::open(const QString &path){
+    file.setFileName(path);
+    if(!file.open(QIODevice::WriteOnly)){
+        return false;
+    }
+    file.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+
+    chunkUsed = 0;
+    ringHead = 0;
+    ringCount = 0;
+    closing = false;
+    opened = true;
+    start();
+    return true;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void TraceWriter::close()
+    ** Description: Hands the last partial chunk to the writer thread, tells it to stop once the
+        ring buffer is empty, and waits for it so the file is complete when this returns.
+**************************************************************************************************/
+void TraceWriter::close(){
+    if(!opened){
+        return;
+    }
+    if(chunkUsed > 0){
+        submitChunk();
+    }
+    mutex.lock();
+    closing = true;
+    chunkReady.wakeOne();
+    mutex.unlock();
+
+    wait();
+    file.close();
+    opened = false;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void TraceWriter::record(Cpu &cpu, uint8_t opcode)
+    ** Description: Encodes the Cpu's state as the record for opcode, storing only the fields
+        that changed since the previous record. The pc usually moves forward by the length of
+        the last instruction, so steps of 1 to 3 are kept in the mask byte instead of in full.
+**************************************************************************************************/
+void TraceWriter::record(Cpu &cpu, uint8_t opcode){
+    TraceRecord current;
+    current.pc = cpu.registers.pc;
+    current.sp = cpu.registers.sp;
+    current.bc = cpu.registers.bc;
+    current.de = cpu.registers.de;
+    current.hl = cpu.registers.hl;
+    current.a = cpu.registers.a;
+    current.flags = cpu.flags.getRegisterValue();
+    current.opcode = opcode;
+
+    //a chunk's first record is stored whole so the chunk can be decoded on its own
+    bool whole = chunkUsed == 0;
+    uint8_t mask = 0;
+    uint16_t step = current.pc - previous.pc;
+    if(!whole && step >= 1 && step <= 3){
+        mask |= step;
+    }
+    if(whole || current.a != previous.a){
+        mask |= TRACE_A;
+    }
+    if(whole || current.flags != previous.flags){
+        mask |= TRACE_FLAGS;
+    }
+    if(whole || current.bc != previous.bc){
+        mask |= TRACE_BC;
+    }
+    if(whole || current.de != previous.de){
+        mask |= TRACE_DE;
+    }
+    if(whole || current.hl != previous.hl){
+        mask |= TRACE_HL;
+    }
+    if(whole || current.sp != previous.sp){
+        mask |= TRACE_SP;
+    }
+
+    uint8_t *out = chunk + chunkUsed;
+    *out++ = mask;
+    *out++ = opcode;
+    if((mask & TRACE_PC_STEP) == 0){
+        *out++ = current.pc;
+        *out++ = current.pc >> 8;
+    }
+    if(mask & TRACE_A){
+        *out++ = current.a;
+    }
+    if(mask & TRACE_FLAGS){
+        *out++ = current.flags;
+    }
+    if(mask & TRACE_BC){
+        *out++ = current.bc;
+        *out++ = current.bc >> 8;
+    }
+    if(mask & TRACE_DE){
+        *out++ = current.de;
+        *out++ = current.de >> 8;
+    }
+    if(mask & TRACE_HL){
+        *out++ = current.hl;
+        *out++ = current.hl >> 8;
+    }
+    if(mask & TRACE_SP){
+        *out++ = current.sp;
+        *out++ = current.sp >> 8;
+    }
+    chunkUsed = out - chunk;
+    previous = current;
+
+    if(chunkUsed >= TRACE_CHUNK_SIZE){
+        submitChunk();
+    }
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void TraceWriter::submitChunk()
+    ** Description: Copies the current chunk into the ring buffer for the writer thread and
+        starts a new one. If the writer has fallen a whole ring buffer behind this waits for a
+        slot rather than dropping records, as a trace with gaps could not be diffed.
+**************************************************************************************************/
+void TraceWriter::submitChunk(){
+    mutex.lock();
+    while(ringCount == TRACE_RING_SLOTS){
+        slotFree.wait(&mutex);
+    }
+    int slot = (ringHead + ringCount) % TRACE_RING_SLOTS;
+    ring[slot] = QByteArray((const char*)chunk, chunkUsed);
+    ringCount++;
+    chunkReady.wakeOne();
+    mutex.unlock();
+
+    chunkUsed = 0;
+}
+
+
+/**************************************************************************************************
+    ** Function Name: void TraceWriter::run()
+    ** Description: The writer thread. Takes chunks out of the ring buffer as they arrive,
+        compresses them outside of the lock and appends them to the file with their size, and
+        returns once close has been called and every chunk has been written.
+**************************************************************************************************/
+void TraceWriter::run(){
+    while(true){
+        mutex.lock();
+        while(ringCount == 0 && !closing){
+            chunkReady.wait(&mutex);
+        }
+        if(ringCount == 0){
+            mutex.unlock();
+            return;
+        }
+        QByteArray raw = ring[ringHead];
+        ring[ringHead].clear();
+        ringHead = (ringHead + 1) % TRACE_RING_SLOTS;
+        ringCount--;
+        slotFree.wakeOne();
+        mutex.unlock();
+
+        QByteArray compressed = qCompress(raw, TRACE_COMPRESSION_LEVEL);
+        uint32_t size = compressed.size();
+        uint8_t sizeBytes[4] = {(uint8_t)size, (uint8_t)(size >> 8), (uint8_t)(size >> 16), (uint8_t)(size >> 24)};
+        if(file.write((const char*)sizeBytes, 4) != 4 || file.write(compressed) != compressed.size()){
+            qWarning("Trace: failed writing to %s", qPrintable(file.fileName()));
+        }
+    }
+}
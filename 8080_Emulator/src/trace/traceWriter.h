@@ -0,0 +1,56 @@
+/**************************************************************************************************
+    ** File Name: traceWriter.h
+    ** Description: This file contains the Class declaration for the TraceWriter class, which
+        records the Cpu state before every instruction into the format described in trace.h.
+        Records are delta encoded into a chunk on the emulation thread; full chunks go through
+        a ring buffer to the writer's own thread, which compresses them and writes them out, so
+        the emulator only waits on the disk when the ring buffer is full.
+**************************************************************************************************/
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "../cpu/cpu.h"
+#include "trace.h"
+
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+
+class TraceWriter : public QThread
+{
+    Q_OBJECT
+public:
+    TraceWriter();                              //default constructor
+    ~TraceWriter();                             //destructor
+
+    bool open(const QString &path);             //creates the file and starts the writer thread
+    void close();                               //writes out what is left and stops the thread
+    bool isOpen();
+
+    void record(Cpu &cpu, uint8_t opcode);      //adds the state before opcode runs to the trace
+
+private:
+    void run();                                 //the writer thread, compresses and writes chunks
+    void submitChunk();
+
+    QFile file;
+    bool opened;
+
+    uint8_t *chunk;                             //records not yet handed to the writer thread
+    int chunkUsed;
+    TraceRecord previous;                       //last record written, records are stored against it
+
+    //full chunks waiting for the writer thread, guarded by mutex
+    QByteArray ring[TRACE_RING_SLOTS];
+    int ringHead;
+    int ringCount;
+    bool closing;
+    QMutex mutex;
+    QWaitCondition chunkReady;
+    QWaitCondition slotFree;
+};
+
+#endif // TRACEWRITER_H